@@ -7,32 +7,102 @@
  *
  * Purpose:	simulate different cpu scheduling algorithms.
  *
- * Comments:Many things took much longer to implement and debug than expected.
- *          Also with large number of jobs it may take a loooooong time to run.
- *          Thus I didn't managed to finish the 500000 runs. They took
- *          way longer to run than I expected. Since it is looping for 10000
- *          times each clock tick. I didn't realize this problem until I
- *          started testing larger number of jobs for the summary table and
- *          that was too late for me to revert to a different solution.
+ * Comments:The simulation is event driven: the clock jumps from one event
+ *          (clock tick, job arrival, scheduler done, context switch done,
+ *          job completion, i/o completion) to the next instead of counting
+ *          every usec, so the running time depends on the number of events
+ *          only; pending events are kept in a hierarchical timing wheel.
  *
  *          You can test my program and see the debug output using small numbers
- *          if you are inpatient. It may seem to run into an infinite loop,
- *          it is not. Rather, it is running some huge loops that takes a
- *          long time.
+ *          by compiling with -DDEBUG.
+ *          Compiled with -DPROFILE, it also prints where each run spent its
+ *          time and how many events, dispatches, preemptions, context
+ *          switches, ticks and arrivals it had.
  */
 
 
 #include    <stdio.h>
 #include    <stdlib.h>
 #include    <stdbool.h>
+#include    <stdint.h>
 #include    <string.h>
 #include    <math.h>
+#include    <time.h>
+#include    <unistd.h>
+#include    <pthread.h>
+#include    <stdatomic.h>
+#include    <fcntl.h>
+#include    <sys/mman.h>
+#include    <sys/stat.h>
 
 #ifdef DEBUG
 #define D_PRNT(...) fprintf(stderr, __VA_ARGS__)
 #else
 #define D_PRNT(...)
 #endif
+//with -DPROFILE every run times its phases and counts what happens in it,
+//see print_profile; without it the PROF_ macros are empty
+#ifdef PROFILE
+#if defined(__x86_64__) || defined(__i386__)
+#include    <x86intrin.h>
+#define     PROF_UNIT               "cycles"
+#else
+#define     PROF_UNIT               "nsec"
+#endif
+enum prof_phase_T
+{
+    PH_OTHER, PH_TIMERS, PH_SCHEDULE, PH_READY, PH_ARRIVALS, PH_STATS,
+    PH_BALANCE, N_PHASES
+};
+enum prof_count_T
+{
+    PC_EVENTS, PC_ARRIVALS, PC_TICKS, PC_SCHEDULER, PC_DISPATCHES,
+    PC_PREEMPTIONS, PC_CONTEXT_SWITCHES, PC_BLOCKS, N_COUNTS
+};
+//each moment of a run is charged to exactly one phase, the one entered
+//last, so nested phases are not counted twice
+struct Profile {
+    uint64_t time[N_PHASES];
+    int64_t count[N_COUNTS];
+    int phase;
+    uint64_t since;
+};
+//the runs of a thread follow each other, the one running counts here
+static _Thread_local struct Profile prof;
+static inline uint64_t prof_clock(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+#endif
+}
+//charges the time since the last switch and enters phase ph, returns the
+//phase left
+static inline int prof_switch(int ph)
+{
+    uint64_t t = prof_clock();
+    int was = prof.phase;
+    prof.time[was] += t - prof.since;
+    prof.since = t;
+    prof.phase = ph;
+    return was;
+}
+#define PROF_BEGIN(ph) int prof_was = prof_switch(ph)
+#define PROF_END() prof_switch(prof_was)
+#define PROF_COUNT(c) (prof.count[c]++)
+#define PROF_START() (memset(&prof, 0, sizeof(prof)), \
+                      prof.since = prof_clock())
+#define PROF_SAVE(s) (prof_switch(PH_OTHER), (s)->prof = prof)
+#else
+#define PROF_BEGIN(ph)
+#define PROF_END()
+#define PROF_COUNT(c)
+#define PROF_START()
+#define PROF_SAVE(s)
+#endif
 //define default values
 #define     DEFAULT_INIT_JOBS        5
 #define     DEFAULT_TOTAL_JOBS        100
@@ -42,14 +112,52 @@
 #define     DEFAULT_TICK_TIME        10            // msec
 #define     DEFAULT_PROB_NEW_JOB    ((double)0.15)
 #define     DEFAULT_RANDOMIZE        false
-#define     MULTI                 10
-//MULTI defines how many times the number of total job is allowed
-/**NOTE: if init_jobs is much larger than total_jobs, this need to change**/
+#define     DEFAULT_SEED            1
+#define     DEFAULT_REPLICATIONS    1
+#define     EXP_BATCH               256           // samples drawn at once
+#define     HIST_SUB_BITS           6             // 64 buckets per octave
+#define     HIST_MAX_BITS           40            // 2^40 usec, about 12 days
+#define     HIST_BUCKETS    ((HIST_MAX_BITS - HIST_SUB_BITS + 1) << HIST_SUB_BITS)
+#define     DEFAULT_WARMUP          0             // jobs, -1 to detect it
+#define     DEFAULT_CI_TARGET       0             // 0 runs all total_jobs
+#define     N_BATCHES               64            // batch means kept per run
+#define     MSER_BATCH              5             // jobs per mser batch
+#define     MLFQ_MAX_LEVELS         64            // one bit each in a mask
+#define     DEFAULT_MLFQ_LEVELS     3
+#define     DEFAULT_MLFQ_BOOST      1000          // msec
+#define     DEFAULT_CFS_LATENCY     24000         // usec
+#define     DEFAULT_CFS_MIN_GRAN    3000          // usec
+#define     NICE_0_WEIGHT           1024
+#define     RECORD_BLOCK            16384         // records per flushed block
+#define     TRACE_CHUNK_BITS        12            // 4096 jobs per chunk
+#define     TRACE_MAX_CHUNKS        (1 << 16)
+#define     DEFAULT_CPUS            1
+#define     MAX_CPUS                1024
+#define     DEFAULT_BALANCE_INTERVAL 10           // msec
+#define     MAX_TENANTS             64
+#define     DEFAULT_TICKETS         100
+#define     PRIO_SCALE   ((int64_t)1 << 32)       // arrivals, orders equal ones
+#define     PRIO_LIMIT   (1 << 30)
+#define     DEFAULT_IO_TIME         10            // msec
+#define     WHEEL_BITS              6
+#define     WHEEL_SLOTS             (1 << WHEEL_BITS)
+#define     WHEEL_LEVELS            11            // 66 bits, any usec
 enum sched_alg_T
 {
-    UNDEFINED, RR, SJF, FCFS
+    UNDEFINED, RR, SJF, FCFS, SRTF, MLFQ, CFS, LOTTERY, STRIDE, EDF, PRIO,
+    PPRIO
+};
+char *alg_names[] = {"UNDEFINED", "RR", "SJF", "FCFS", "SRTF", "MLFQ", "CFS",
+                     "LOTTERY", "STRIDE", "EDF", "PRIO", "PPRIO"};
+//how the jobs are spread over the cpus: all from one global queue (new
+//jobs wait in it until a cpu has nothing to run), idle cpus stealing from
+//busy ones or jobs pushed from the busiest to the idlest cpu every
+//balance_interval
+enum balance_T
+{
+    BAL_GLOBAL, BAL_STEAL, BAL_PUSH
 };
-char *alg_names[] = {"UNDEFINED", "RR", "SJF", "FCFS"};
+char *balance_names[] = {"global", "steal", "push"};
 
 struct simulation_params
 {
@@ -62,6 +170,67 @@ struct simulation_params
     int tick_time;
     double prob_new_job;
     bool randomize;
+    uint64_t seed; //replication r uses seed + r
+    int replications;
+    int threads;
+    const char *csv; //file for the results of a sweep, stdout if not set
+    bool crn; //all algorithms run on one shared workload
+    //steady state: the first warmup finished jobs are left out of the
+    //statistics (-1 finds the warm-up with mser-5), and with a ci_target
+    //the run stops early once the 95% confidence interval of every mean is
+    //narrower than ci_target times the mean; total_jobs is then the limit
+    int warmup;
+    double ci_target;
+    const char *record; //file every scheduling event is recorded to
+    const char *decode; //recorded file to print instead of simulating
+    const char *workload; //file the jobs are replayed from
+    const char *convert; //csv turned into the workload file instead
+    const struct Workload *replay; //the workload file once it is mapped
+    //mlfq: the number of levels, the quantum of each one in ticks and how
+    //often all jobs go back to the top level, in msec (0 never)
+    int mlfq_levels;
+    int mlfq_quanta[MLFQ_MAX_LEVELS];
+    int mlfq_boost;
+    //cfs: the period in which every job should run once and the least a
+    //job runs before it can be stopped, in usec
+    int cfs_latency;
+    int cfs_min_gran;
+    //every cpu has its own queue of waiting jobs, scheduler and context
+    //switches; balance_interval is in msec, for the push balancing
+    int cpus;
+    enum balance_T balance;
+    int balance_interval;
+    //job k belongs to tenant k % tenants and holds the tickets of its
+    //tenant, for lottery and stride and the cpu share of each tenant
+    int tenants;
+    int tickets[MAX_TENANTS];
+    //generated jobs get a priority from 0 (the most urgent) to
+    //priorities - 1, and a deadline of deadline times their cpu time after
+    //they arrive; 0 for either leaves the jobs without, unless the
+    //workload file has them
+    int priorities;
+    double deadline;
+    //every job does io_bursts i/o bursts evenly spread over its cpu time,
+    //each one of io_time msec on average
+    int io_bursts;
+    double io_time;
+};
+
+//values of the parameters that can be swept, each one a list of one or
+//more values given as "a,b,c" or ranges "from:to[:step]"
+struct value_list
+{
+    double *v;
+    int n;
+};
+struct sweep_lists
+{
+    struct value_list algs;
+    struct value_list total_jobs;
+    struct value_list lambdas;
+    struct value_list cs_times;
+    struct value_list tick_times;
+    struct value_list prob_new_jobs;
 };
 
 char *progname;
@@ -71,7 +240,8 @@ void usage(const char *message)
     fprintf(stderr, "%s", message);
     fprintf(stderr, "Usage: %s <arguments>\nwhere the arguments are:\n",
             progname);
-    fprintf(stderr, "\t-alg [rr|sjf|fcfs]\n"
+    fprintf(stderr, "\t-alg [rr|sjf|srtf|fcfs|mlfq|cfs|lottery|stride|edf|"
+                    "prio|pprio]\n"
                     "\t[-init_jobs <n1 (int)>\n"
                     "\t[-total_jobs <n2 (int)>]\n"
                     "\t[-prob_comp_time <lambda (double)>]\n"
@@ -79,10 +249,114 @@ void usage(const char *message)
                     "\t[-cs_time <cs (int, microseconds)>]\n"
                     "\t[-tick_time <cs (int, milliseconds)>]\n"
                     "\t[-prob_new_job <pnj (double)>]\n"
-                    "\t[-randomize]\n");
+                    "\t[-randomize]\n"
+                    "\t[-replications <n (int)>]\n"
+                    "\t[-threads <t (int)>]\n"
+                    "\t[-csv <file>]\n"
+                    "\t[-crn]\n"
+                    "\t[-warmup <n (int)|auto>]\n"
+                    "\t[-ci_target <relative half width (double)>]\n"
+                    "\t[-record <file>]\n"
+                    "\t[-workload <file>]\n"
+                    "\t[-mlfq_levels <n (int)>]\n"
+                    "\t[-mlfq_quanta <q1,q2,... (ints, ticks)>]\n"
+                    "\t[-mlfq_boost <b (int, milliseconds)>]\n"
+                    "\t[-cfs_latency <l (int, microseconds)>]\n"
+                    "\t[-cfs_min_gran <g (int, microseconds)>]\n"
+                    "\t[-cpus <n (int)>]\n"
+                    "\t[-balance [global|steal|push]]\n"
+                    "\t[-balance_interval <b (int, milliseconds)>]\n"
+                    "\t[-tickets <t1,t2,... (ints, one per tenant)>]\n"
+                    "\t[-priorities <n (int)>]\n"
+                    "\t[-deadline <times the cpu time (double)>]\n"
+                    "\t[-io_bursts <n (int)>]\n"
+                    "\t[-io_time <t (double, milliseconds)>]\n"
+                    "or, to print a recorded file as text or as csv:\n"
+                    "\t-decode <file> [-csv <file>]\n"
+                    "or, to turn a csv with rows of arrival time, cpu time "
+                    "(both usec)\nand optionally priority and relative "
+                    "deadline (usec) into a workload file:\n"
+                    "\t-convert <csv> -workload <file>\n"
+                    "-alg, -total_jobs, -prob_comp_time, -cs_time, -tick_time"
+                    " and -prob_new_job\n"
+                    "also take lists (a,b,c) and ranges (from:to[:step]),\n"
+                    "all combinations are then run and put into tables\n");
+}
+
+void list_add(struct value_list *l, double v)
+{
+    l->v = realloc(l->v, (l->n + 1) * sizeof(double));
+    l->v[l->n++] = v;
+}
+void sweep_free(struct sweep_lists *sw)
+{
+    free(sw->algs.v);
+    free(sw->total_jobs.v);
+    free(sw->lambdas.v);
+    free(sw->cs_times.v);
+    free(sw->tick_times.v);
+    free(sw->prob_new_jobs.v);
+}
+//reads a number, which has to be a whole one if integer is set
+static int parse_value(const char *str, bool integer, double *v)
+{
+    char *end;
+    *v = strtod(str, &end);
+    if (end == str || (*end != '\0' && *end != ':' && *end != ','))
+        return 1;
+    if (integer && *v != (long)*v)
+        return 1;
+    return 0;
+}
+//parses a list like "50,100,500:2000:500" and returns the smallest value
+//in min, non-zero is returned for a malformed list
+int parse_list(const char *arg, bool integer, struct value_list *l,
+               double *min)
+{
+    l->n = 0;
+    while (*arg)
+    {
+        double from, to, step = 1;
+        if (parse_value(arg, integer, &from))
+            return 1;
+        to = from;
+        arg += strcspn(arg, ":,");
+        if (*arg == ':')
+        {
+            if (parse_value(++arg, integer, &to))
+                return 1;
+            arg += strcspn(arg, ":,");
+            if (*arg == ':')
+            {
+                if (parse_value(++arg, integer, &step) || step <= 0)
+                    return 1;
+                arg += strcspn(arg, ":,");
+            }
+        }
+        //the small slack keeps "0.1:0.3:0.1" from losing its end
+        for (int k = 0; from + k * step <= to + step * 1e-9; ++k)
+            list_add(l, from + k * step);
+        if (*arg == ',')
+            arg++;
+    }
+    if (l->n == 0)
+        return 1;
+    *min = l->v[0];
+    for (int k = 1; k < l->n; ++k)
+        if (l->v[k] < *min)
+            *min = l->v[k];
+    return 0;
 }
 
-int process_args(int argc, char *argv[], struct simulation_params *sps)
+//an option that takes a value is the last argument
+static int missing_argument(const char *option)
+{
+    fprintf(stderr, "Error: missing argument to %s", option);
+    usage("\n");
+    return 1;
+}
+int process_args(int argc, char *argv[], struct simulation_params *sps,
+                 struct sweep_lists *sw)
 {
     // Process the command-line arguments.
     // The only one which doesn't have a default (and thus must be
@@ -90,23 +364,52 @@ int process_args(int argc, char *argv[], struct simulation_params *sps)
 
     char c;
     int i;
+    double min;
 
-    for (i = 1; i < argc - 1; i++) {
+    for (i = 1; i < argc; i++) {
         if (!strcmp(argv[i], "-alg")) {
-            i++;
-            if (!strcmp(argv[i], "rr"))
-                sps->sched_alg = RR;
-            else if (!strcmp(argv[i], "sjf"))
-                sps->sched_alg = SJF;
-            else if (!strcmp(argv[i], "fcfs"))
-                sps->sched_alg = FCFS;
-            else {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            sw->algs.n = 0;
+            for (char *name = strtok(argv[i], ","); name;
+                 name = strtok(NULL, ",")) {
+                if (!strcmp(name, "rr"))
+                    sps->sched_alg = RR;
+                else if (!strcmp(name, "sjf"))
+                    sps->sched_alg = SJF;
+                else if (!strcmp(name, "srtf"))
+                    sps->sched_alg = SRTF;
+                else if (!strcmp(name, "mlfq"))
+                    sps->sched_alg = MLFQ;
+                else if (!strcmp(name, "cfs"))
+                    sps->sched_alg = CFS;
+                else if (!strcmp(name, "lottery"))
+                    sps->sched_alg = LOTTERY;
+                else if (!strcmp(name, "stride"))
+                    sps->sched_alg = STRIDE;
+                else if (!strcmp(name, "edf"))
+                    sps->sched_alg = EDF;
+                else if (!strcmp(name, "prio"))
+                    sps->sched_alg = PRIO;
+                else if (!strcmp(name, "pprio"))
+                    sps->sched_alg = PPRIO;
+                else if (!strcmp(name, "fcfs"))
+                    sps->sched_alg = FCFS;
+                else {
+                    usage("Error: invalid scheduling algorithm (-alg).\n");
+                    return 1;
+                }
+                list_add(&sw->algs, sps->sched_alg);
+            }
+            if (sw->algs.n == 0) {
                 usage("Error: invalid scheduling algorithm (-alg).\n");
                 return 1;
             }
+            sps->sched_alg = (enum sched_alg_T)sw->algs.v[0];
         }
         else if (!strcmp(argv[i], "-init_jobs")) {
-            i++;
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
             if (sscanf(argv[i], "%d%c", &sps->init_jobs, &c) != 1
                 || sps->init_jobs < 0) {
                 usage("Error: invalid argument to -init_jobs\n");
@@ -114,23 +417,28 @@ int process_args(int argc, char *argv[], struct simulation_params *sps)
             }
         }
         else if (!strcmp(argv[i], "-total_jobs")) {
-            i++;
-            if (sscanf(argv[i], "%d%c", &sps->total_jobs, &c) != 1
-                || sps->total_jobs < 0) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (parse_list(argv[i], true, &sw->total_jobs, &min)
+                || min < 0) {
                 usage("Error: invalid argument to -total_jobs\n");
                 return 1;
             }
+            sps->total_jobs = (int)sw->total_jobs.v[0];
         }
         else if (!strcmp(argv[i], "-prob_comp_time")) {
-            i++;
-            if (sscanf(argv[i], "%lf%c", &sps->lambda, &c) != 1
-                || sps->lambda < 0) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (parse_list(argv[i], false, &sw->lambdas, &min)
+                || min < 0) {
                 usage("Error: invalid argument to -prob_comp_time\n");
                 return 1;
             }
+            sps->lambda = sw->lambdas.v[0];
         }
         else if (!strcmp(argv[i], "-sched_time")) {
-            i++;
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
             if (sscanf(argv[i], "%d%c", &sps->sched_time, &c) != 1
                 || sps->sched_time < 0) {
                 usage("Error: invalid argument to -sched_time\n");
@@ -138,31 +446,240 @@ int process_args(int argc, char *argv[], struct simulation_params *sps)
             }
         }
         else if (!strcmp(argv[i], "-cs_time")) {
-            i++;
-            if (sscanf(argv[i], "%d%c", &sps->cont_swtch_time, &c) != 1
-                || sps->cont_swtch_time < 0) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (parse_list(argv[i], true, &sw->cs_times, &min)
+                || min < 0) {
                 usage("Error: invalid argument to -cs_time\n");
                 return 1;
             }
+            sps->cont_swtch_time = (int)sw->cs_times.v[0];
         }
         else if (!strcmp(argv[i], "-tick_time")) {
-            i++;
-            if (sscanf(argv[i], "%d%c", &sps->tick_time, &c) != 1
-                || sps->tick_time < 0) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (parse_list(argv[i], true, &sw->tick_times, &min)
+                || min <= 0) {
                 usage("Error: invalid argument to -tick_time\n");
                 return 1;
             }
+            sps->tick_time = (int)sw->tick_times.v[0];
         }
         else if (!strcmp(argv[i], "-prob_new_job")) {
-            i++;
-            if (sscanf(argv[i], "%lf%c", &sps->prob_new_job, &c) != 1
-                || sps->prob_new_job <= 0) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (parse_list(argv[i], false, &sw->prob_new_jobs, &min)
+                || min <= 0) {
                 usage("Error: invalid argument to -prob_new_job\n");
                 return 1;
             }
+            sps->prob_new_job = sw->prob_new_jobs.v[0];
+        }
+        else if (!strcmp(argv[i], "-replications")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (sscanf(argv[i], "%d%c", &sps->replications, &c) != 1
+                || sps->replications <= 0) {
+                usage("Error: invalid argument to -replications\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-threads")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (sscanf(argv[i], "%d%c", &sps->threads, &c) != 1
+                || sps->threads <= 0) {
+                usage("Error: invalid argument to -threads\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-csv")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            sps->csv = argv[i];
+        }
+        else if (!strcmp(argv[i], "-warmup")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (!strcmp(argv[i], "auto"))
+                sps->warmup = -1;
+            else if (sscanf(argv[i], "%d%c", &sps->warmup, &c) != 1
+                     || sps->warmup < 0) {
+                usage("Error: invalid argument to -warmup\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-ci_target")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (sscanf(argv[i], "%lf%c", &sps->ci_target, &c) != 1
+                || sps->ci_target <= 0) {
+                usage("Error: invalid argument to -ci_target\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-record")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            sps->record = argv[i];
+        }
+        else if (!strcmp(argv[i], "-decode")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            sps->decode = argv[i];
+        }
+        else if (!strcmp(argv[i], "-workload")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            sps->workload = argv[i];
+        }
+        else if (!strcmp(argv[i], "-convert")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            sps->convert = argv[i];
+        }
+        else if (!strcmp(argv[i], "-mlfq_levels")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (sscanf(argv[i], "%d%c", &sps->mlfq_levels, &c) != 1
+                || sps->mlfq_levels <= 0
+                || sps->mlfq_levels > MLFQ_MAX_LEVELS) {
+                usage("Error: invalid argument to -mlfq_levels\n");
+                return 1;
+            }
+            //each level twice as long as the one above it
+            for (int k = 0; k < sps->mlfq_levels; ++k)
+                sps->mlfq_quanta[k] = 1 << (k < 20 ? k : 20);
+        }
+        else if (!strcmp(argv[i], "-mlfq_quanta")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            struct value_list quanta = {0};
+            if (parse_list(argv[i], true, &quanta, &min) || min < 1
+                || quanta.n > MLFQ_MAX_LEVELS) {
+                free(quanta.v);
+                usage("Error: invalid argument to -mlfq_quanta\n");
+                return 1;
+            }
+            sps->mlfq_levels = quanta.n;
+            for (int k = 0; k < quanta.n; ++k)
+                sps->mlfq_quanta[k] = (int)quanta.v[k];
+            free(quanta.v);
+        }
+        else if (!strcmp(argv[i], "-mlfq_boost")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (sscanf(argv[i], "%d%c", &sps->mlfq_boost, &c) != 1
+                || sps->mlfq_boost < 0) {
+                usage("Error: invalid argument to -mlfq_boost\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-cfs_latency")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (sscanf(argv[i], "%d%c", &sps->cfs_latency, &c) != 1
+                || sps->cfs_latency <= 0) {
+                usage("Error: invalid argument to -cfs_latency\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-cfs_min_gran")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (sscanf(argv[i], "%d%c", &sps->cfs_min_gran, &c) != 1
+                || sps->cfs_min_gran < 0) {
+                usage("Error: invalid argument to -cfs_min_gran\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-cpus")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (sscanf(argv[i], "%d%c", &sps->cpus, &c) != 1
+                || sps->cpus <= 0 || sps->cpus > MAX_CPUS) {
+                usage("Error: invalid argument to -cpus\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-balance")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (!strcmp(argv[i], "global"))
+                sps->balance = BAL_GLOBAL;
+            else if (!strcmp(argv[i], "steal"))
+                sps->balance = BAL_STEAL;
+            else if (!strcmp(argv[i], "push"))
+                sps->balance = BAL_PUSH;
+            else {
+                usage("Error: invalid argument to -balance\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-balance_interval")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (sscanf(argv[i], "%d%c", &sps->balance_interval, &c) != 1
+                || sps->balance_interval <= 0) {
+                usage("Error: invalid argument to -balance_interval\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-tickets")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            struct value_list tickets = {0};
+            if (parse_list(argv[i], true, &tickets, &min) || min < 1
+                || tickets.n > MAX_TENANTS) {
+                free(tickets.v);
+                usage("Error: invalid argument to -tickets\n");
+                return 1;
+            }
+            sps->tenants = tickets.n;
+            for (int k = 0; k < tickets.n; ++k)
+                sps->tickets[k] = (int)tickets.v[k];
+            free(tickets.v);
+        }
+        else if (!strcmp(argv[i], "-priorities")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (sscanf(argv[i], "%d%c", &sps->priorities, &c) != 1
+                || sps->priorities < 0) {
+                usage("Error: invalid argument to -priorities\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-deadline")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (sscanf(argv[i], "%lf%c", &sps->deadline, &c) != 1
+                || !(sps->deadline >= 0)) {
+                usage("Error: invalid argument to -deadline\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-io_bursts")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (sscanf(argv[i], "%d%c", &sps->io_bursts, &c) != 1
+                || sps->io_bursts < 0) {
+                usage("Error: invalid argument to -io_bursts\n");
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-io_time")) {
+            if (++i == argc)
+                return missing_argument(argv[i - 1]);
+            if (sscanf(argv[i], "%lf%c", &sps->io_time, &c) != 1
+                || !(sps->io_time > 0)) {
+                usage("Error: invalid argument to -io_time\n");
+                return 1;
+            }
         }
         else if (!strcmp(argv[i], "-randomize"))
             sps->randomize = true;
+        else if (!strcmp(argv[i], "-crn"))
+            sps->crn = true;
         //check for invalid arguments
         else
         {
@@ -174,39 +691,116 @@ int process_args(int argc, char *argv[], struct simulation_params *sps)
     return 0;
 }
 
-//generates random compute time in secs
-double rand_exp(double lambda)
+//xoshiro256** (Blackman and Vigna), small and fast; every simulation has a
+//stream of its own so parallel runs neither share nor lock any state
+struct Rng {
+    uint64_t s[4];
+};
+static inline uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+static inline uint64_t rng_next(struct Rng *r)
+{
+    uint64_t *s = r->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+//the output function of splitmix64, scrambles close numbers apart
+static inline uint64_t mix64(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+//the state is filled with splitmix64, so close seeds give unrelated streams
+void rng_seed(struct Rng *r, uint64_t seed)
+{
+    for (int i = 0; i < 4; ++i)
+        r->s[i] = mix64(seed += 0x9e3779b97f4a7c15ULL);
+}
+//natural log of x > 0 without branches, library calls or int/double
+//conversions, so the loop around it vectorizes with plain SSE2:
+//x = m * 2^e with m in [sqrt(1/2), sqrt(2)), then
+//log(m) = 2 atanh((m-1)/(m+1)) summed up to the 13th power; the error is
+//below 5e-13, far under the 1 usec the samples are rounded to
+static inline double fast_log(double x)
 {
-    int64_t divisor = (int64_t)RAND_MAX + 1;
-    double u_0_to_almost_1;
-    double raw_value;
-    u_0_to_almost_1 = (double)random() / divisor;
-    raw_value = log(1 - u_0_to_almost_1) / -lambda;
-    return round(raw_value * 1000000.) / 1000000.;
+    const uint64_t mant_mask = 0x000fffffffffffffULL;
+    const uint64_t sqrt2_mant = 0x0006a09e667f3bcdULL; //of sqrt(2)
+    uint64_t bits, mbits, ebits;
+    double m, e;
+    memcpy(&bits, &x, sizeof(bits));
+    //1 when the mantissa is at least sqrt(2), then m is halved instead
+    uint64_t big = ((bits & mant_mask) + (mant_mask + 1 - sqrt2_mant)) >> 52;
+    mbits = ((bits & mant_mask) | 0x3ff0000000000000ULL) - (big << 52);
+    memcpy(&m, &mbits, sizeof(m));
+    //2^52 + biased exponent, read back as a double and unbiased
+    ebits = ((bits >> 52) + big) | 0x4330000000000000ULL;
+    memcpy(&e, &ebits, sizeof(e));
+    e -= 0x1.0p52 + 1023;
+    double z = (m - 1) / (m + 1), z2 = z * z;
+    double p = 1.0 / 13;
+    p = p * z2 + 1.0 / 11;
+    p = p * z2 + 1.0 / 9;
+    p = p * z2 + 1.0 / 7;
+    p = p * z2 + 1.0 / 5;
+    p = p * z2 + 1.0 / 3;
+    p = p * z2 + 1.0;
+    return e * M_LN2 + 2 * z * p;
 }
-//define struct job
+//fills buf with exponential samples of mean 1; the top 52 bits of each
+//random number become a double in [1, 2), and 2 minus that is a uniform
+//number in (0, 1] whose log is always finite
+void exp_batch(struct Rng *r, double *buf, int n)
+{
+    uint64_t raw[EXP_BATCH];
+    for (int i = 0; i < n; ++i)
+        raw[i] = (rng_next(r) >> 12) | 0x3ff0000000000000ULL;
+    for (int i = 0; i < n; ++i)
+    {
+        double d;
+        memcpy(&d, &raw[i], sizeof(d));
+        buf[i] = -fast_log(2.0 - d);
+    }
+}
+//define struct job, only the fields used when a job is added or finishes
+//the ones the scheduler touches all the time are kept in separate arrays
+//in struct Simulation so they are packed densely
 struct Job {
     //usec
-    int64_t remaining;
     int64_t generated; // time when the job entered
     int64_t compute_time;
-    int64_t passed_time;
-    int state; //running = 0,waiting = 1,finished = 2
     int64_t wait_time;
     int64_t response_time;
     int64_t turnaround_time;
+    int id; //order of arrival, for the recorded events
+    //from the workload file or drawn with -priorities, else 0; the
+    //lowest runs first with prio, it is the nice value for cfs
+    int priority;
+    int64_t deadline; //usec, INT64_MAX if it has none
+    int64_t burst; //cpu time between two i/o bursts
+    int io_done; //i/o bursts so far
+    int tenant;
+    int tickets; //of its tenant, for lottery and stride
+    int weight; //cfs, from the nice value; stride, its tickets
+    //cfs, usec run scaled by NICE_0_WEIGHT / weight; the pass of stride
+    int64_t vruntime;
     bool new;
 };
-//function that generates a job and initialize it
-struct Job getJob(double lambda, int64_t time)
+//function that initializes a job
+struct Job getJob(int64_t time, int64_t compute_time)
 {
-    int64_t tmp = rand_exp(lambda)*1000000;
     struct Job j = {
             .generated = time,
-            .compute_time = tmp,
-            .remaining = tmp,
-            .passed_time = 0,
-            .state = 1,
+            .compute_time = compute_time,
             .wait_time = 0,
             .response_time = 0,
             .turnaround_time = 0,
@@ -214,298 +808,2890 @@ struct Job getJob(double lambda, int64_t time)
     };
     return j;
 }
-//returns the job index that has the shortest remaining time
-int shortest(struct Job * job,int c)
+//where the jobs come from: init_jobs jobs at time 0, then a poisson process
+//with prob_new_job new jobs per tick on average
+struct JobSource {
+    const struct simulation_params *sp;
+    struct Rng rng;
+    double exp_buf[EXP_BATCH]; //exponential samples of mean 1
+    int exp_left;
+    int init_left;
+    double usec_per_arrival;
+    double next_arrival; //in usecs, kept unrounded so errors do not add up
+};
+void source_init(struct JobSource *src, const struct simulation_params *sp)
+{
+    memset(src, 0, sizeof(*src));
+    src->sp = sp;
+    src->init_left = sp->init_jobs;
+    src->usec_per_arrival = sp->tick_time * 1000 / sp->prob_new_job;
+    rng_seed(&src->rng, sp->seed);
+}
+//exponential sample of mean 1, taken from a batch drawn in one go
+static inline double source_exp(struct JobSource *src)
 {
-    int x = 0;//index
-    int temp = job[0].remaining;
-    for (int i = 1; i < c; ++i)
+    if (src->exp_left == 0)
     {
-        if (job[i].remaining<temp&&job[i].state!=2)
-        {
-            temp = job[i].remaining;
-            x = i;
-        }
+        exp_batch(&src->rng, src->exp_buf, EXP_BATCH);
+        src->exp_left = EXP_BATCH;
     }
-    return x;
+    return src->exp_buf[EXP_BATCH - src->exp_left--];
 }
-int main(int argc, char *argv[])
+//draws the next job, the time between two arrivals is exponential
+void source_next(struct JobSource *src, int64_t *time, int64_t *compute_time)
 {
-    progname = argv[0];
-    struct simulation_params sim_params = {
-            .sched_alg = UNDEFINED,
-            .init_jobs = DEFAULT_INIT_JOBS,
-            .total_jobs = DEFAULT_TOTAL_JOBS,
-            .lambda = DEFAULT_LAMBDA,
-            .sched_time = DEFAULT_SCHED_TIME,
-            .cont_swtch_time = DEFAULT_CONT_SWTCH_TIME,
-            .tick_time = DEFAULT_TICK_TIME,
-            .prob_new_job = DEFAULT_PROB_NEW_JOB,
-            .randomize = DEFAULT_RANDOMIZE
-    };
-
-    if (process_args(argc, argv, &sim_params) != 0)
-        return EXIT_FAILURE;
-
-    //set random flags
-    if (sim_params.randomize == true)
-        srandom(NULL);
-    if (sim_params.sched_alg == UNDEFINED)
+    if (src->init_left > 0)
     {
-        //quit if no scheduling algorithm is specified
-        usage("No schedule algorithm is specified\n");
-        return EXIT_FAILURE;
+        src->init_left--;
+        *time = 0;
     }
-    double average_response_time = 0;
-    double average_waiting_time = 0;
-    double average_turnaround_time = 0;
-
-    int64_t clock_usec = -1;
-    //2 times the amount of total jobs just in case
-    //The program break if I don't do that
-    struct Job * jobs = malloc(MULTI*sim_params.total_jobs*9*sizeof(int64_t));
-    int job_count = 0;
-    int finished_jobs = 0;
-    bool tick = false;
-    //initialize the jobs
-    for (int i = 0; i < sim_params.init_jobs; ++i)
+    else
     {
-        jobs[i] = getJob(sim_params.lambda, 0);
-        D_PRNT("t=%d,job %d is added, needing %ld usec\n",0,i,jobs[i]
-        .compute_time);
-
+        src->next_arrival += source_exp(src) * src->usec_per_arrival;
+        *time = llround(src->next_arrival);
     }
-    job_count = sim_params.init_jobs;
-    int64_t scheduler_start_time = 0; //the time a scheduler starts
-    int64_t cs_start_time = sim_params.sched_time; //time context switch starts
-    bool scheduler_running = false;
-    bool context_switch_running = false;
-    bool job_scheduled = false;
-    //to keep track of the jobs
-    int previous_job_index = 0;
-    int current_job_index = 0;
-    while (finished_jobs<sim_params.total_jobs)
+    //compute times are exponential with lambda per sec, rounded to usecs
+    *compute_time = llround(source_exp(src) * 1000000 / src->sp->lambda);
+    //a job needs at least 1 usec, one rounded down to 0 would never finish
+    if (*compute_time < 1)
+        *compute_time = 1;
+}
+//a workload generated once and read by several simulations at the same
+//time; it is extended on demand, but a job never changes once it is in it.
+//chunks never move, so jobs below n can be read without the lock
+struct Trace {
+    pthread_mutex_t lock;
+    struct JobSource src;
+    int64_t *time[TRACE_MAX_CHUNKS];
+    int64_t *compute_time[TRACE_MAX_CHUNKS];
+    atomic_int n; //jobs generated so far
+};
+struct Trace *trace_new(const struct simulation_params *sp)
+{
+    struct Trace *tr = calloc(1, sizeof(struct Trace));
+    pthread_mutex_init(&tr->lock, NULL);
+    source_init(&tr->src, sp);
+    atomic_init(&tr->n, 0);
+    return tr;
+}
+void trace_free(struct Trace *tr)
+{
+    int chunks = (atomic_load(&tr->n) >> TRACE_CHUNK_BITS) + 1;
+    for (int c = 0; c < chunks && c < TRACE_MAX_CHUNKS; ++c)
+    {
+        free(tr->time[c]);
+        free(tr->compute_time[c]);
+    }
+    pthread_mutex_destroy(&tr->lock);
+    free(tr);
+}
+//job k of the trace, generating the chunk it is in if nobody has yet
+void trace_get(struct Trace *tr, int k, int64_t *time, int64_t *compute_time)
+{
+    int c = k >> TRACE_CHUNK_BITS, i = k & ((1 << TRACE_CHUNK_BITS) - 1);
+    if (k >= atomic_load_explicit(&tr->n, memory_order_acquire))
     {
-        clock_usec++;//increments time in usec
-        if (clock_usec%(sim_params.tick_time*1000)==0)
+        pthread_mutex_lock(&tr->lock);
+        while (k >= atomic_load_explicit(&tr->n, memory_order_relaxed))
         {
-            //clock tick and runs the scheduler
-            //if the current job is running, it is stopped
-            if (jobs[current_job_index].state==0)
-            {
-                D_PRNT("t=%ld,clock ticks,current running process %d stops\n",
-                        clock_usec,current_job_index);
-                jobs[current_job_index].state = 1;
-            }
-            if (context_switch_running&&cs_start_time<clock_usec)
-                context_switch_running = false;
-            scheduler_running = true;
-            scheduler_start_time = clock_usec;
-            //a new job generates and I put a hard limit here
-            if((random()%(int)(100*sim_params.prob_new_job))==0
-            &&job_count<sim_params.total_jobs*MULTI)
+            int n = atomic_load_explicit(&tr->n, memory_order_relaxed);
+            int nc = n >> TRACE_CHUNK_BITS;
+            if (nc >= TRACE_MAX_CHUNKS)
             {
-                jobs[job_count] = getJob(sim_params.lambda, clock_usec);
-                D_PRNT("t=%ld,job %d is added, needing %ld usec\n",clock_usec,
-                       job_count, jobs[job_count].compute_time);
-                job_count++;
-            }
-            //special handling for rr
-            if (sim_params.sched_alg == RR)
-            {
-                previous_job_index = current_job_index;
-                while (current_job_index<job_count)
-                {
-                    if (current_job_index == job_count - 1)
-                        current_job_index = 0;
-                    else
-                        current_job_index++;
-                    if (jobs[current_job_index].state==2)
-                        continue;
-                    if (jobs[current_job_index].new)
-                    {
-                        //respond time is not calculated correctly
-                        jobs[current_job_index].response_time =
-                                scheduler_start_time -
-                                jobs[current_job_index].generated;
-                        jobs[current_job_index].new =false;
-                    }
-                    if (current_job_index != previous_job_index)
-                    {
-                        context_switch_running = true;
-                        cs_start_time = scheduler_start_time +sim_params
-                                .sched_time;
-                    }
-                    break;
-                }
+                fprintf(stderr, "Error: the shared workload is full\n");
+                exit(EXIT_FAILURE);
             }
+            tr->time[nc] = malloc(sizeof(int64_t) << TRACE_CHUNK_BITS);
+            tr->compute_time[nc] = malloc(sizeof(int64_t) << TRACE_CHUNK_BITS);
+            for (int j = 0; j < 1 << TRACE_CHUNK_BITS; ++j)
+                source_next(&tr->src, &tr->time[nc][j],
+                            &tr->compute_time[nc][j]);
+            atomic_store_explicit(&tr->n, n + (1 << TRACE_CHUNK_BITS),
+                                  memory_order_release);
         }
-        //scheduler is running
-        if (scheduler_running)
+        pthread_mutex_unlock(&tr->lock);
+    }
+    *time = tr->time[c][i];
+    *compute_time = tr->compute_time[c][i];
+}
+//a recorded workload replayed with -workload: a header and then the
+//columns, arrival times and cpu times in usec and, if there are any,
+//relative deadlines in usec (0 for none) and priorities; the file is
+//mapped, never read into memory, so all runs share its pages and traces
+//larger than memory stream from disk
+static const char workload_magic[8] = "A3WL01";
+struct WorkloadHeader {
+    char magic[8];
+    int64_t n; //jobs
+    int32_t has_priority;
+    int32_t has_deadline;
+    int64_t reserved;
+};
+struct Workload {
+    const int64_t *arrival; //non-decreasing
+    const int64_t *compute_time;
+    const int64_t *deadline; //NULL if the file has none
+    const int32_t *priority; //NULL if the file has none
+    int64_t n;
+    void *map;
+    size_t size;
+};
+static size_t workload_size(int64_t n, bool has_priority, bool has_deadline)
+{
+    return sizeof(struct WorkloadHeader) +
+           n * (has_deadline ? 3 : 2) * sizeof(int64_t) +
+           (has_priority ? n * sizeof(int32_t) : 0);
+}
+int workload_open(struct Workload *w, const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        perror(path);
+        if (fd >= 0)
+            close(fd);
+        return 1;
+    }
+    w->size = (size_t)st.st_size;
+    w->map = w->size >= sizeof(struct WorkloadHeader) ?
+             mmap(NULL, w->size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    const struct WorkloadHeader *h = w->map;
+    if (w->map == MAP_FAILED ||
+        memcmp(h->magic, workload_magic, sizeof(h->magic)) != 0 ||
+        h->n < 0 || w->size != workload_size(h->n, h->has_priority,
+                                             h->has_deadline))
+    {
+        fprintf(stderr, "%s: not a workload file\n", path);
+        if (w->map != MAP_FAILED)
+            munmap(w->map, w->size);
+        return 1;
+    }
+    //it is read front to back, so the kernel may read ahead a lot
+    madvise(w->map, w->size, MADV_SEQUENTIAL);
+    w->n = h->n;
+    w->arrival = (const int64_t *)(h + 1);
+    w->compute_time = w->arrival + w->n;
+    w->deadline = h->has_deadline ? w->compute_time + w->n : NULL;
+    w->priority = h->has_priority ? (const int32_t *)(w->compute_time +
+                  (h->has_deadline ? 2 : 1) * w->n) : NULL;
+    return 0;
+}
+void workload_close(struct Workload *w)
+{
+    munmap(w->map, w->size);
+}
+//reads the rows of a csv, skipping the ones that do not start with a
+//number such as a header; stores them in w if it is not NULL, else only
+//counts them and finds out whether there are priorities and deadlines
+static int csv_rows(FILE *in, const char *path, int64_t *n,
+                    bool *has_priority, bool *has_deadline, struct Workload *w)
+{
+    char line[256];
+    int64_t row = 0, last = 0, line_no = 0;
+    while (fgets(line, sizeof(line), in))
+    {
+        long long arrival, compute_time, deadline = 0;
+        int priority = 0;
+        line_no++;
+        int got = sscanf(line, "%lld ,%lld ,%d ,%lld", &arrival,
+                         &compute_time, &priority, &deadline);
+        if (got <= 0)
+            continue;
+        if (got == 1 || arrival < last || compute_time < 1)
         {
-            if (clock_usec != scheduler_start_time + sim_params.sched_time)
-                continue;
-            else
-            {
-                scheduler_running = false;//scheduler finish
-                //D_PRNT("t=%ld,scheduler done\n",clock_usec);
-            }
+            fprintf(stderr, "%s:%ld: need arrival time (non-decreasing) "
+                            "and cpu time (>= 1)\n", path, (long)line_no);
+            return 1;
         }
-        //context switch is running
-        if (context_switch_running &&clock_usec != cs_start_time + sim_params
-        .cont_swtch_time)
+        last = arrival;
+        if (got >= 3)
+            *has_priority = true;
+        if (got == 4)
+            *has_deadline = true;
+        if (w)
         {
-            continue;
+            ((int64_t *)w->arrival)[row] = arrival;
+            ((int64_t *)w->compute_time)[row] = compute_time;
+            if (w->deadline)
+                ((int64_t *)w->deadline)[row] = deadline > 0 ? deadline : 0;
+            if (w->priority)
+                ((int32_t *)w->priority)[row] = priority;
         }
-        if (clock_usec == cs_start_time + sim_params.cont_swtch_time) {
-            context_switch_running = false;//cs finish
-            //D_PRNT("t=%ld,context switch done\n",clock_usec);
-        }
-        if (jobs[current_job_index].state==2&&sim_params.sched_alg==FCFS)
+        row++;
+    }
+    *n = row;
+    return 0;
+}
+//turns a csv into a workload file, in two passes over the csv so neither
+//of them is ever held in memory
+int workload_convert(const char *csv, const char *path)
+{
+    FILE *in = fopen(csv, "r");
+    int64_t n = 0;
+    bool has_priority = false, has_deadline = false;
+    if (!in)
+    {
+        perror(csv);
+        return 1;
+    }
+    if (csv_rows(in, csv, &n, &has_priority, &has_deadline, NULL))
+    {
+        fclose(in);
+        return 1;
+    }
+    size_t size = workload_size(n, has_priority, has_deadline);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    void *map = MAP_FAILED;
+    if (fd >= 0 && ftruncate(fd, (off_t)size) == 0)
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (fd >= 0)
+        close(fd);
+    if (map == MAP_FAILED)
+    {
+        perror(path);
+        fclose(in);
+        return 1;
+    }
+    struct WorkloadHeader *h = map;
+    memcpy(h->magic, workload_magic, sizeof(h->magic));
+    h->n = n;
+    h->has_priority = has_priority;
+    h->has_deadline = has_deadline;
+    struct Workload w = {.arrival = (const int64_t *)(h + 1), .n = n};
+    w.compute_time = w.arrival + n;
+    w.deadline = has_deadline ? w.compute_time + n : NULL;
+    w.priority = has_priority ? (const int32_t *)(w.compute_time +
+                 (has_deadline ? 2 : 1) * n) : NULL;
+    rewind(in);
+    int ret = csv_rows(in, csv, &n, &has_priority, &has_deadline, &w);
+    munmap(map, size);
+    fclose(in);
+    if (!ret)
+        printf("%s: %ld jobs%s%s\n", path, (long)n,
+               has_priority ? " with priorities" : "",
+               has_deadline ? " and deadlines" : "");
+    return ret;
+}
+//indexed binary min-heap of jobs, the keys are kept in the heap itself and
+//every job knows its own position so it can be taken out of the middle in
+//O(log n)
+struct HeapEntry {
+    int64_t key;
+    int job;
+};
+struct JobHeap {
+    struct HeapEntry *e;
+    int size;
+    int cap;
+};
+//smaller key first, lower index on ties
+static bool entry_before(struct HeapEntry a, struct HeapEntry b)
+{
+    return a.key < b.key || (a.key == b.key && a.job < b.job);
+}
+static void heap_place(struct JobHeap *h, int *heap_pos, int pos,
+                       struct HeapEntry e)
+{
+    h->e[pos] = e;
+    heap_pos[e.job] = pos;
+}
+static void heap_sift_up(struct JobHeap *h, int *heap_pos, int pos)
+{
+    struct HeapEntry e = h->e[pos];
+    while (pos > 0 && entry_before(e, h->e[(pos - 1) / 2]))
+    {
+        heap_place(h, heap_pos, pos, h->e[(pos - 1) / 2]);
+        pos = (pos - 1) / 2;
+    }
+    heap_place(h, heap_pos, pos, e);
+}
+static void heap_sift_down(struct JobHeap *h, int *heap_pos, int pos)
+{
+    struct HeapEntry e = h->e[pos];
+    while (2 * pos + 1 < h->size)
+    {
+        int c = 2 * pos + 1;
+        if (c + 1 < h->size && entry_before(h->e[c + 1], h->e[c]))
+            c++;
+        if (!entry_before(h->e[c], e))
+            break;
+        heap_place(h, heap_pos, pos, h->e[c]);
+        pos = c;
+    }
+    heap_place(h, heap_pos, pos, e);
+}
+void heap_push(struct JobHeap *h, int *heap_pos, int job, int64_t key)
+{
+    if (h->size == h->cap)
+    {
+        h->cap = h->cap ? h->cap * 2 : 16;
+        h->e = realloc(h->e, h->cap * sizeof(struct HeapEntry));
+    }
+    struct HeapEntry e = {.key = key, .job = job};
+    heap_place(h, heap_pos, h->size++, e);
+    heap_sift_up(h, heap_pos, h->size - 1);
+}
+void heap_remove(struct JobHeap *h, int *heap_pos, int job)
+{
+    int pos = heap_pos[job];
+    struct HeapEntry last = h->e[--h->size];
+    heap_pos[job] = -1;
+    if (pos == h->size)
+        return;
+    heap_place(h, heap_pos, pos, last);
+    //the moved job may have to go either way
+    heap_sift_up(h, heap_pos, pos);
+    heap_sift_down(h, heap_pos, heap_pos[last.job]);
+}
+//changes the key of a job that is in the heap
+void heap_update(struct JobHeap *h, int *heap_pos, int job, int64_t key)
+{
+    h->e[heap_pos[job]].key = key;
+    heap_sift_up(h, heap_pos, heap_pos[job]);
+    heap_sift_down(h, heap_pos, heap_pos[job]);
+}
+//circular fifo of job indices, the rr run queue
+struct RunQueue {
+    int *idx;
+    int head;
+    int count;
+    int cap;
+};
+static void rq_grow(struct RunQueue *q)
+{
+    if (q->count == q->cap)
+    {
+        //unwrap into a buffer twice as large
+        int cap = q->cap ? q->cap * 2 : 16;
+        int *idx = malloc(cap * sizeof(int));
+        for (int i = 0; i < q->count; ++i)
+            idx[i] = q->idx[(q->head + i) % q->cap];
+        free(q->idx);
+        q->idx = idx;
+        q->head = 0;
+        q->cap = cap;
+    }
+}
+void rq_push(struct RunQueue *q, int job)
+{
+    rq_grow(q);
+    q->idx[(q->head + q->count++) % q->cap] = job;
+}
+//puts a job back in front, for one that was stopped before its time
+void rq_push_front(struct RunQueue *q, int job)
+{
+    rq_grow(q);
+    q->head = (q->head + q->cap - 1) % q->cap;
+    q->idx[q->head] = job;
+    q->count++;
+}
+int rq_pop(struct RunQueue *q)
+{
+    int job = q->idx[q->head];
+    q->head = (q->head + 1) % q->cap;
+    q->count--;
+    return job;
+}
+//takes the job at the back, the one that joined last
+int rq_pop_back(struct RunQueue *q)
+{
+    return q->idx[(q->head + --q->count) % q->cap];
+}
+//fenwick tree of the tickets of the waiting jobs by slot, for lottery: a
+//draw finds the job that holds a given ticket in O(log n) instead of
+//walking all the jobs; sum[k] holds the tickets of the slots
+//k - (k & -k) to k - 1, n is a power of two
+struct TicketTree {
+    int64_t *sum;
+    int n;
+    int64_t total;
+};
+void ticket_add(struct TicketTree *t, int slot, int64_t tickets)
+{
+    t->total += tickets;
+    for (int k = slot + 1; k <= t->n; k += k & -k)
+        t->sum[k] += tickets;
+}
+//the slot that holds ticket r, 0 <= r < total
+int ticket_find(const struct TicketTree *t, int64_t r)
+{
+    int pos = 0;
+    for (int step = t->n; step > 0; step >>= 1)
+        if (pos + step <= t->n && t->sum[pos + step] <= r)
         {
-            if (current_job_index==job_count-1)
-                continue;
+            pos += step;
+            r -= t->sum[pos];
         }
-        //if the current job is running
-        if (jobs[current_job_index].state==0)
+    return pos;
+}
+//makes room for n slots; the nodes of the new half cover new slots only,
+//but the last one, which covers them all
+void ticket_grow(struct TicketTree *t, int n)
+{
+    t->sum = realloc(t->sum, (n + 1) * sizeof(int64_t));
+    memset(&t->sum[t->n + 1], 0, (n - t->n) * sizeof(int64_t));
+    t->sum[n] = t->total;
+    t->n = n;
+}
+//streaming statistics of one kind of time over the finished jobs, in usec:
+//welford's mean and variance, the max and a log-linear histogram for the
+//percentiles, exact below 128 usec and within 1/128 of the value above
+//that; all of it is O(1) per job, fixed size and can be merged
+struct Stats {
+    int64_t n;
+    double mean;
+    double m2; //sum of the squared differences from the mean
+    int64_t max;
+    int64_t hist[HIST_BUCKETS];
+};
+static int hist_bucket(int64_t v)
+{
+    if (v < 0)
+        v = 0;
+    if (v >= (int64_t)1 << HIST_MAX_BITS)
+        v = ((int64_t)1 << HIST_MAX_BITS) - 1;
+    if (v < 1 << HIST_SUB_BITS)
+        return (int)v;
+    int octave = 63 - __builtin_clzll((unsigned long long)v);
+    int shift = octave - HIST_SUB_BITS;
+    return ((shift + 1) << HIST_SUB_BITS) +
+           (int)(v >> shift) - (1 << HIST_SUB_BITS);
+}
+//middle of the values that fall into bucket b
+static int64_t hist_value(int b)
+{
+    if (b < 1 << HIST_SUB_BITS)
+        return b;
+    int shift = (b >> HIST_SUB_BITS) - 1;
+    int64_t low = (int64_t)((b & ((1 << HIST_SUB_BITS) - 1)) +
+                            (1 << HIST_SUB_BITS)) << shift;
+    return low + (((int64_t)1 << shift) - 1) / 2;
+}
+void stats_add(struct Stats *st, int64_t v)
+{
+    double d = (double)v - st->mean;
+    st->n++;
+    st->mean += d / st->n;
+    st->m2 += d * ((double)v - st->mean);
+    if (v > st->max)
+        st->max = v;
+    st->hist[hist_bucket(v)]++;
+}
+//adds the jobs of from to into, as if into had seen them as well
+void stats_merge(struct Stats *into, const struct Stats *from)
+{
+    int64_t n = into->n + from->n;
+    if (n == 0)
+        return;
+    double d = from->mean - into->mean;
+    into->mean += d * from->n / n;
+    into->m2 += from->m2 + d * d * ((double)into->n * from->n / n);
+    into->n = n;
+    if (from->max > into->max)
+        into->max = from->max;
+    for (int b = 0; b < HIST_BUCKETS; ++b)
+        into->hist[b] += from->hist[b];
+}
+//the following are in seconds
+double stats_mean(const struct Stats *st)
+{
+    return st->mean / 1000000;
+}
+double stats_sd(const struct Stats *st)
+{
+    return st->n > 1 ? sqrt(st->m2 / (st->n - 1)) / 1000000 : 0;
+}
+double stats_max(const struct Stats *st)
+{
+    return (double)st->max / 1000000;
+}
+//value below which a fraction q of the jobs lie
+double stats_percentile(const struct Stats *st, double q)
+{
+    int64_t rank = (int64_t)ceil(q * st->n), seen = 0;
+    if (rank < 1)
+        rank = 1;
+    for (int b = 0; b < HIST_BUCKETS; ++b)
+    {
+        seen += st->hist[b];
+        if (seen >= rank)
         {
-            //increment time count
-            jobs[current_job_index].passed_time++;
-            jobs[current_job_index].remaining--;
-            jobs[current_job_index].turnaround_time++;
-            //if at current time the job finishes
-            if (jobs[current_job_index].passed_time ==
-            jobs[current_job_index].compute_time || jobs[current_job_index]
-            .remaining ==0)
-            {
-                //current job finishes
-                jobs[current_job_index].state=2;
-                finished_jobs++;
-                //adds to statistics in seconds
-                average_response_time += (double)
-                        jobs[current_job_index].response_time/sim_params
-                        .total_jobs/1000000;
-                average_turnaround_time += (double)
-                        jobs[current_job_index].turnaround_time/sim_params
-                        .total_jobs/1000000;
-                if (sim_params.sched_alg==FCFS)
-                    average_waiting_time += (double)
-                        jobs[current_job_index].response_time/sim_params
-                        .total_jobs/1000000;
-                else
-                    average_waiting_time += (double)
-                            jobs[current_job_index].wait_time/sim_params
-                                                    .total_jobs/1000000;
-                previous_job_index = current_job_index;
-                D_PRNT("t=%ld,process %d finished\n", clock_usec,
-                        current_job_index);
-                D_PRNT("job %d respond=%ld,wait=%ld,turnaround=%ld\n",
-                        current_job_index,jobs[current_job_index]
-                        .response_time,jobs[current_job_index].wait_time,
-                        jobs[current_job_index].turnaround_time);
-            }
+            int64_t v = hist_value(b);
+            return (double)(v < st->max ? v : st->max) / 1000000;
         }
-
-        if (sim_params.sched_alg == FCFS)
-        {
-            //FCFS
-            if (jobs[current_job_index].state == 1)
-            {
-                jobs[current_job_index].state = 0;
-                D_PRNT("t=%ld,dispatching process %d,needing %ld usec\n",
-                       scheduler_start_time, current_job_index,
-                       jobs[current_job_index].compute_time);
-            }
-            if (jobs[current_job_index].state == 2 && job_count >
-                                                      current_job_index + 1)
-            {
-                //previous job finished and there are jobs left
-                current_job_index++;
-                //runs scheduler at next usec
-                scheduler_running = true;
-                scheduler_start_time = clock_usec;
-                //runs context switch after the scheduler finish
-                context_switch_running = true;
-                cs_start_time = scheduler_start_time + sim_params.sched_time;
-                jobs[current_job_index] .response_time = scheduler_start_time -
-                        jobs[current_job_index].generated;
-                jobs[current_job_index].wait_time = jobs[current_job_index]
-                        .response_time;
-                continue;
-
-            }
+    }
+    return stats_max(st);
+}
+//two-sided 95% quantile of student's t distribution
+double t_quantile_95(int dof)
+{
+    static const double table[] = {
+            12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+            2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101,
+            2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052,
+            2.048, 2.045, 2.042
+    };
+    if (dof <= 30)
+        return table[dof - 1];
+    //close enough beyond the table
+    return 1.960 + 2.4 / dof;
+}
+//batch means of one kind of time, for a confidence interval of its mean
+//from a single run; once N_BATCHES batches are full neighbours are merged
+//and the batches get twice as long, so memory stays fixed and the batches
+//grow long enough to be close to independent
+struct BatchMeans {
+    int64_t size; //jobs per batch
+    int64_t in_batch;
+    double sum;
+    double mean[N_BATCHES];
+    int n;
+};
+//returns true when v completes a batch
+static bool batch_add(struct BatchMeans *b, int64_t v)
+{
+    if (b->size == 0)
+        b->size = 1;
+    b->sum += (double)v;
+    if (++b->in_batch < b->size)
+        return false;
+    b->mean[b->n++] = b->sum / (double)b->size;
+    b->sum = 0;
+    b->in_batch = 0;
+    if (b->n == N_BATCHES)
+    {
+        for (int k = 0; k < N_BATCHES / 2; ++k)
+            b->mean[k] = (b->mean[2 * k] + b->mean[2 * k + 1]) / 2;
+        b->n = N_BATCHES / 2;
+        b->size *= 2;
+    }
+    return true;
+}
+//mean of the full batches and the half width of its 95% confidence
+//interval, in seconds; the half width is 0 with fewer than 2 batches
+void batch_ci(const struct BatchMeans *b, double *mean, double *half_width)
+{
+    double m = 0, var = 0;
+    for (int k = 0; k < b->n; ++k)
+        m += b->mean[k] / b->n;
+    for (int k = 0; k < b->n; ++k)
+        var += (b->mean[k] - m) * (b->mean[k] - m) / (b->n - 1);
+    *mean = m / 1000000;
+    *half_width = b->n < 2 ? 0 :
+                  t_quantile_95(b->n - 1) * sqrt(var / b->n) / 1000000;
+}
+//mser-5 (white et al.): the number of values to drop from the n taken
+//stride apart from v, in whole batches of MSER_BATCH, that minimises the
+//variance of the mean of what is left
+static int64_t mser5(const int64_t *v, int64_t n, int stride)
+{
+    int64_t m = n / MSER_BATCH, best = 0;
+    double *z = malloc((m + 1) * sizeof(double));
+    for (int64_t j = 0; j < m; ++j)
+    {
+        z[j] = 0;
+        for (int k = 0; k < MSER_BATCH; ++k)
+            z[j] += (double)v[(j * MSER_BATCH + k) * stride] / MSER_BATCH;
+    }
+    //from the back, so the sums of what is left are at hand for each d
+    double sum = 0, sq = 0, best_stat = INFINITY;
+    for (int64_t d = m - 1; d >= 0; --d)
+    {
+        sum += z[d];
+        sq += z[d] * z[d];
+        int64_t left = m - d;
+        if (left < 2)
+            continue;
+        double stat = (sq - sum * sum / left) / ((double)left * left);
+        if (stat <= best_stat)
+        {
+            best_stat = stat;
+            best = d;
         }
-        if (sim_params.sched_alg == SJF)
+    }
+    free(z);
+    return best * MSER_BATCH;
+}
+//what -record writes: a file header, then blocks of up to RECORD_BLOCK
+//fixed size records of one run each, every block after a struct
+//RecordBlock; the blocks of parallel runs interleave in the file but the
+//records of one run stay in order
+enum record_T
+{
+    REC_ARRIVAL, REC_DISPATCH, REC_PREEMPT, REC_COMPLETE, REC_TICK,
+    REC_SCHEDULER, REC_CONTEXT_SWITCH, REC_MIGRATE, REC_BLOCK, REC_WAKE
+};
+char *record_names[] = {"arrival", "dispatch", "preempt", "complete", "tick",
+                        "scheduler", "context switch", "migrate", "block",
+                        "wake"};
+static const char record_magic[8] = "A3REC01";
+struct EventRecord {
+    int64_t time; //usec
+    int32_t job; //id of the job, -1 for the events without one
+    int16_t kind;
+    int16_t cpu; //the one it happened on, a migration names the one it left
+};
+struct RecordBlock {
+    int32_t run; //number of the task in the sweep
+    int32_t count;
+};
+//the file shared by all runs
+struct Recorder {
+    FILE *f;
+    pthread_mutex_t lock;
+};
+void recorder_write(struct Recorder *r, int run, const struct EventRecord *rec,
+                    int count)
+{
+    struct RecordBlock b = {.run = run, .count = count};
+    pthread_mutex_lock(&r->lock);
+    fwrite(&b, sizeof(b), 1, r->f);
+    fwrite(rec, sizeof(*rec), count, r->f);
+    pthread_mutex_unlock(&r->lock);
+}
+//prints a recorded file as text, or as csv into csv if it is not NULL
+int decode_records(const char *path, const char *csv)
+{
+    FILE *in = fopen(path, "rb"), *out = stdout;
+    char magic[sizeof(record_magic)];
+    if (!in)
+    {
+        perror(path);
+        return 1;
+    }
+    if (fread(magic, sizeof(magic), 1, in) != 1 ||
+        memcmp(magic, record_magic, sizeof(magic)) != 0)
+    {
+        fprintf(stderr, "%s: not a recorded file\n", path);
+        fclose(in);
+        return 1;
+    }
+    if (csv && !(out = fopen(csv, "w")))
+    {
+        perror(csv);
+        fclose(in);
+        return 1;
+    }
+    if (csv)
+        fprintf(out, "run,cpu,time,job,event\n");
+    struct EventRecord *rec = malloc(RECORD_BLOCK * sizeof(*rec));
+    struct RecordBlock b;
+    int ret = 0;
+    while (fread(&b, sizeof(b), 1, in) == 1)
+    {
+        if (b.count < 0 || b.count > RECORD_BLOCK ||
+            fread(rec, sizeof(*rec), b.count, in) != (size_t)b.count)
+        {
+            fprintf(stderr, "%s: truncated block\n", path);
+            ret = 1;
+            break;
+        }
+        for (int k = 0; k < b.count; ++k)
         {
-            if (jobs[current_job_index].state==1)
-                job_scheduled = false;
+            const char *name = rec[k].kind >= 0 && rec[k].kind <=
+                               REC_WAKE ? record_names[rec[k].kind]
+                                           : "unknown";
+            if (csv)
+                fprintf(out, "%d,%d,%ld,%d,%s\n", b.run, rec[k].cpu,
+                        (long)rec[k].time, rec[k].job, name);
+            else if (rec[k].job >= 0)
+                printf("run %d,cpu %d,t=%ld,job %d,%s\n", b.run, rec[k].cpu,
+                       (long)rec[k].time, rec[k].job, name);
+            else
+                printf("run %d,cpu %d,t=%ld,%s\n", b.run, rec[k].cpu,
+                       (long)rec[k].time, name);
+        }
+    }
+    free(rec);
+    fclose(in);
+    if (csv)
+        fclose(out);
+    return ret;
+}
+//kinds of events, same-time events are handled in this order
+enum event_T
+{
+    EV_IO_DONE, EV_TICK, EV_ARRIVAL, EV_SCHED_DONE, EV_CS_DONE, EV_JOB_DONE
+};
+struct Event {
+    int64_t time; //usec
+    enum event_T type;
+    int job; //the job whose i/o ends, -1 for the others
+};
+//hierarchical timing wheel of the pending events: level l has
+//WHEEL_SLOTS slots of WHEEL_SLOTS^l usec each, and an event sits at the
+//lowest level where it is in a later slot than now, so level 0 only holds
+//events of the current WHEEL_SLOTS usec, one slot per usec; an event is
+//filed in O(1), and when the clock moves into a slot of a higher level
+//the events in it are filed again lower down, each one at most once per
+//level; the slots are lists threaded through the events
+struct TimerWheel {
+    struct Event *ev;
+    int *link; //next event in the same slot or in the free list, -1 at the end
+    int cap;
+    int free; //first unused event, if count < cap
+    int count;
+    int64_t now; //time of the last event taken out
+    int64_t next; //time of the earliest event, INT64_MAX if there is none
+    uint64_t mask[WHEEL_LEVELS]; //bit k is set if slot k has events
+    int head[WHEEL_LEVELS][WHEEL_SLOTS];
+    int tail[WHEEL_LEVELS][WHEEL_SLOTS];
+    int64_t first[WHEEL_LEVELS][WHEEL_SLOTS]; //the earliest time in a slot
+};
+static void wheel_file(struct TimerWheel *w, int e)
+{
+    int64_t time = w->ev[e].time > w->now ? w->ev[e].time : w->now;
+    int l = time == w->now ? 0 :
+            (63 - __builtin_clzll((uint64_t)(time ^ w->now))) / WHEEL_BITS;
+    int k = (int)(time >> (l * WHEEL_BITS)) & (WHEEL_SLOTS - 1);
+    w->link[e] = -1;
+    if (w->mask[l] >> k & 1)
+    {
+        w->link[w->tail[l][k]] = e;
+        if (w->ev[e].time < w->first[l][k])
+            w->first[l][k] = w->ev[e].time;
+    }
+    else
+    {
+        w->head[l][k] = e;
+        w->first[l][k] = w->ev[e].time;
+        w->mask[l] |= (uint64_t)1 << k;
+    }
+    w->tail[l][k] = e;
+}
+void wheel_add(struct TimerWheel *w, int64_t time, enum event_T type,
+               int job)
+{
+    if (w->count == w->cap)
+    {
+        int cap = w->cap ? w->cap * 2 : 16;
+        w->ev = realloc(w->ev, cap * sizeof(struct Event));
+        w->link = realloc(w->link, cap * sizeof(int));
+        for (int e = w->cap; e < cap; ++e)
+            w->link[e] = e + 1 < cap ? e + 1 : -1;
+        w->free = w->cap;
+        w->cap = cap;
+    }
+    PROF_BEGIN(PH_TIMERS);
+    int e = w->free;
+    w->free = w->link[e];
+    w->ev[e] = (struct Event){.time = time, .type = type, .job = job};
+    w->count++;
+    wheel_file(w, e);
+    if (w->count == 1 || time < w->next)
+        w->next = time;
+    PROF_END();
+}
+//the time of the earliest event, INT64_MAX if there is none
+static inline int64_t wheel_next(const struct TimerWheel *w)
+{
+    return w->count > 0 ? w->next : INT64_MAX;
+}
+//takes out the earliest event, the first of the earliest type of those at
+//its time; there has to be one
+struct Event wheel_pop(struct TimerWheel *w)
+{
+    PROF_BEGIN(PH_TIMERS);
+    int l = 0;
+    while (!w->mask[l])
+        l++;
+    int k = __builtin_ctzll(w->mask[l]);
+    if (l > 0 && w->head[l][k] != w->tail[l][k])
+    {
+        //the clock moves into slot k of level l, its events go lower down
+        int e = w->head[l][k];
+        w->now = w->first[l][k];
+        w->mask[l] &= ~((uint64_t)1 << k);
+        while (e >= 0)
+        {
+            int next = w->link[e];
+            wheel_file(w, e);
+            e = next;
+        }
+        l = 0;
+        k = __builtin_ctzll(w->mask[0]);
+    }
+    //a slot with a single event is taken out as it is
+    else if (w->first[l][k] > w->now)
+        w->now = w->first[l][k];
+    int best = w->head[l][k], before = -1;
+    for (int e = w->link[best], p = best; e >= 0; p = e, e = w->link[e])
+        if (w->ev[e].type < w->ev[best].type)
+        {
+            best = e;
+            before = p;
+        }
+    if (before < 0)
+        w->head[l][k] = w->link[best];
+    else
+        w->link[before] = w->link[best];
+    if (w->tail[l][k] == best)
+        w->tail[l][k] = before;
+    if (w->head[l][k] < 0)
+        w->mask[l] &= ~((uint64_t)1 << k);
+    struct Event ev = w->ev[best];
+    w->link[best] = w->free;
+    w->free = best;
+    w->count--;
+    //the lowest level that has events holds the earliest one, in its first
+    //slot that has any
+    for (l = 0; l < WHEEL_LEVELS && w->count > 0; ++l)
+        if (w->mask[l])
+        {
+            w->next = w->first[l][__builtin_ctzll(w->mask[l])];
+            break;
+        }
+    PROF_END();
+    return ev;
+}
+//a job on its way to a cpu, a new one or one that moves to another cpu;
+//its vruntime is kept relative to the min_vruntime of the cpu it left
+struct Migrant {
+    struct Job job;
+    int64_t remaining;
+    int64_t io_at;
+    int level;
+    bool migrated; //else it is a new arrival
+};
+//fifo of the jobs sent to a cpu, each one joins it at an EV_ARRIVAL
+struct Inbox {
+    struct Migrant *m;
+    int head;
+    int count;
+    int cap;
+};
+static void inbox_push(struct Inbox *q, const struct Migrant *m)
+{
+    if (q->count == q->cap)
+    {
+        int cap = q->cap ? q->cap * 2 : 16;
+        struct Migrant *grown = malloc(cap * sizeof(struct Migrant));
+        for (int i = 0; i < q->count; ++i)
+            grown[i] = q->m[(q->head + i) % q->cap];
+        free(q->m);
+        q->m = grown;
+        q->head = 0;
+        q->cap = cap;
+    }
+    q->m[(q->head + q->count++) % q->cap] = *m;
+}
+static struct Migrant inbox_pop(struct Inbox *q)
+{
+    struct Migrant m = q->m[q->head];
+    q->head = (q->head + 1) % q->cap;
+    q->count--;
+    return m;
+}
+//what is left of each cpu of a run with -cpus
+struct CpuReport {
+    int64_t busy_usec; //run by jobs
+    int64_t idle_usec;
+    int64_t end_usec; //its clock at the end of the run
+    int finished;
+    int migrated_in;
+    int migrated_out;
+};
+//all the state of one simulation run
+struct Simulation {
+    const struct simulation_params *sp;
+    //jobs live in growable arrays, slots of finished jobs are reused so
+    //they only grow with the number of jobs alive at the same time
+    struct Job *jobs;
+    //running = 0,waiting = 1,finished = 2,blocked on i/o = 3
+    signed char *state;
+    int64_t *remaining; //usec
+    int64_t *io_at; //remaining when the next i/o starts, 0 if no more
+    int64_t *ready_since; //ready clock when the job last became waiting
+    int *heap_pos; //position in the ready heap, -1 if not in it
+    signed char *level; //mlfq level, 0 is the top
+    int *used; //ticks run at that level, mlfq
+    int job_count; //slots handed out so far
+    int job_cap;
+    int *free_slots;
+    int free_count;
+    int finished_jobs;
+    int64_t clock_usec;
+    int64_t scheduler_start_time; //the time a scheduler starts
+    int64_t cs_start_time; //time context switch starts
+    bool scheduler_running;
+    bool context_switch_running;
+    bool job_scheduled;
+    bool tick; //a clock tick happened at clock_usec
+    //to keep track of the jobs
+    int previous_job_index;
+    int current_job_index;
+    struct TimerWheel events;
+    struct JobHeap ready; //waiting jobs, only kept for sjf and srtf
+    struct RunQueue run_queue; //waiting jobs but the current one, fcfs/rr
+    //mlfq: one queue of waiting jobs per level, bit l of level_mask is set
+    //if level l has any, so the top one that has is found in O(1)
+    struct RunQueue *levels;
+    uint64_t level_mask;
+    int64_t next_boost; //usec
+    //cfs: the waiting jobs are in ready, keyed on vruntime
+    int64_t min_vruntime; //never goes back, new jobs start from it
+    int64_t cfs_load; //weights of the jobs that are not finished
+    int64_t charged_remaining; //of the current job when it was last charged
+    int64_t picked_remaining; //of the current job when it was picked
+    //usecs in which waiting jobs are charged, i.e. the ones where neither
+    //the scheduler nor a context switch is running
+    int64_t ready_clock;
+    //lottery: the tickets of the waiting jobs and the draws, a stream of
+    //its own so the jobs are the same as with the other algorithms
+    struct TicketTree tickets;
+    struct Rng sched_rng;
+    int64_t tenant_usec[MAX_TENANTS]; //cpu time each tenant got
+    //jobs come from the shared trace if there is one, else from source
+    struct Trace *trace;
+    int trace_next;
+    struct JobSource source;
+    int64_t next_compute_time; //of the job that arrives next
+    int next_priority;
+    int64_t next_deadline; //relative, 0 if it has none
+    struct Stats response;
+    struct Stats waiting;
+    struct Stats turnaround;
+    //of the jobs with a deadline, how late they finished (0 if in time),
+    //over the whole run
+    struct Stats tardiness;
+    int64_t missed;
+    //steady state, see struct simulation_params
+    int64_t warmup; //jobs left out, -1 while it is still being detected
+    int64_t seen; //finished jobs so far, the warm-up ones included
+    int64_t *early; //response, turnaround and waiting time of each finished
+    int64_t early_cap; //job while the warm-up is detected
+    struct BatchMeans batches[3]; //response, turnaround and waiting time
+    bool converged;
+    bool no_steady_state; //mser-5 could not find the end of the warm-up
+    int next_id; //of the next job to arrive
+    //events of this run wait here until a whole block goes to recorder
+    struct Recorder *recorder; //NULL if nothing is recorded
+    struct EventRecord *records;
+    int n_records;
+    int run;
+    //with -cpus every cpu is a simulation of its own and parent holds what
+    //they share: the jobs to come, the statistics and the recorded events
+    struct Simulation *parent; //NULL unless this is one of the cpus
+    int cpu;
+    int n_jobs; //jobs that are not finished, the ones on their way too
+    int n_waiting; //jobs in state 1, a preempted current one too
+    struct Inbox inbox;
+    bool tickless; //the clock of an idle cpu stops ticking
+    int64_t busy_usec; //a job ran
+    int64_t idle_usec; //no job ran or waited
+    int64_t n_events; //handled, all cpus together for the parent
+#ifdef PROFILE
+    struct Profile prof; //the whole run, all cpus together
+#endif
+    int migrated_in;
+    int migrated_out;
+    int idle_cpus; //parent: cpus without jobs
+    int n_cpus; //parent: cpus of the run, their report is kept in cpus
+    struct CpuReport *cpus;
+};
+//records an event of the job in slot i, or of no job if i < 0; costs a
+//branch when nothing is recorded and a store into the block otherwise
+static inline void record(struct Simulation *s, int64_t time,
+                          enum record_T kind, int i)
+{
+    //the cpus share the block of their parent
+    struct Simulation *p = s->parent ? s->parent : s;
+    if (!p->recorder)
+        return;
+    if (p->n_records == RECORD_BLOCK)
+    {
+        recorder_write(p->recorder, p->run, p->records, p->n_records);
+        p->n_records = 0;
+    }
+    struct EventRecord *r = &p->records[p->n_records++];
+    r->time = time;
+    r->job = i < 0 ? -1 : s->jobs[i].id;
+    r->kind = (int16_t)kind;
+    r->cpu = (int16_t)s->cpu;
+}
+//queues a waiting job on its mlfq level
+static void mlfq_push(struct Simulation *s, int i, bool front)
+{
+    int l = s->level[i];
+    if (front)
+        rq_push_front(&s->levels[l], i);
+    else
+        rq_push(&s->levels[l], i);
+    s->level_mask |= (uint64_t)1 << l;
+}
+static int mlfq_pop(struct Simulation *s, int l)
+{
+    int i = rq_pop(&s->levels[l]);
+    if (s->levels[l].count == 0)
+        s->level_mask &= ~((uint64_t)1 << l);
+    return i;
+}
+//cfs weight of a nice value, the table of linux: each step is about 10%
+//more or less cpu
+static int cfs_weight(int nice)
+{
+    static const int weights[40] = {
+            88761, 71755, 56483, 46273, 36291, 29154, 23254, 18705, 14949,
+            11916, 9548, 7620, 6100, 4904, 3906, 3121, 2501, 1991, 1586, 1277,
+            1024, 820, 655, 526, 423, 335, 272, 215, 172, 137, 110, 87, 70, 56,
+            45, 36, 29, 23, 18, 15
+    };
+    nice = nice < -20 ? -20 : (nice > 19 ? 19 : nice);
+    return weights[nice + 20];
+}
+//the algorithms that run the job with the least key in the ready heap
+//until it finishes or is stopped, instead of picking one at every tick
+static bool runs_least(enum sched_alg_T alg)
+{
+    return alg == SJF || alg == SRTF || alg == EDF || alg == PRIO ||
+           alg == PPRIO;
+}
+//the key of a job in the ready heap: the least runs first; prio orders
+//jobs of the same priority by their id, the order of arrival, and not by
+//the arrival time, which a long trace can make as large as any key; the
+//priority is clamped to +-PRIO_LIMIT so the key stays within +-2^62
+static int64_t ready_key(const struct Simulation *s, int i)
+{
+    const struct Job *j = &s->jobs[i];
+    int prio = j->priority;
+    switch (s->sp->sched_alg)
+    {
+        case CFS: case STRIDE: return j->vruntime;
+        case EDF: return j->deadline;
+        case PRIO: case PPRIO:
+            prio = prio < -PRIO_LIMIT ? -PRIO_LIMIT :
+                   (prio > PRIO_LIMIT ? PRIO_LIMIT : prio);
+            return prio * PRIO_SCALE + (uint32_t)j->id;
+        default: return s->remaining[i];
+    }
+}
+//a job starts waiting
+static void ready_enter(struct Simulation *s, int i)
+{
+    PROF_BEGIN(PH_READY);
+    s->ready_since[i] = s->ready_clock;
+    s->n_waiting++;
+    enum sched_alg_T alg = s->sp->sched_alg;
+    if (alg == LOTTERY)
+        ticket_add(&s->tickets, i, s->jobs[i].tickets);
+    else if (runs_least(alg) || alg == CFS || alg == STRIDE)
+        heap_push(&s->ready, s->heap_pos, i, ready_key(s, i));
+    //a preempted job is queued again when the next one is picked
+    else if (i != s->current_job_index)
+    {
+        if (s->sp->sched_alg == MLFQ)
+            mlfq_push(s, i, false);
+        else
+            rq_push(&s->run_queue, i);
+    }
+    PROF_END();
+}
+//a job stops waiting, it is charged for the time it spent waiting
+static void ready_leave(struct Simulation *s, int i)
+{
+    PROF_BEGIN(PH_READY);
+    struct Job *j = &s->jobs[i];
+    int64_t waited = s->ready_clock - s->ready_since[i];
+    //fcfs counts the wait until the job first runs when it is picked,
+    //only the waits after an i/o are added here
+    if (s->sp->sched_alg!=FCFS || j->io_done > 0)
+        j->wait_time += waited;
+    j->turnaround_time += waited;
+    s->n_waiting--;
+    if (s->sp->sched_alg == LOTTERY)
+        ticket_add(&s->tickets, i, -j->tickets);
+    if (s->heap_pos[i] >= 0)
+        heap_remove(&s->ready, s->heap_pos, i);
+    PROF_END();
+}
+//changes the state of a job, so no job has to be touched while it waits
+static void set_state(struct Simulation *s, int i, int state)
+{
+    //a job is charged for the time it ran when it stops, to its tenant
+    //and to its vruntime or pass
+    enum sched_alg_T alg = s->sp->sched_alg;
+    if (s->state[i] != state)
+    {
+        if (s->state[i] == 0)
+        {
+            int64_t ran = s->charged_remaining - s->remaining[i];
+            s->tenant_usec[s->jobs[i].tenant] += ran;
+            if (alg == CFS || alg == STRIDE)
+                s->jobs[i].vruntime += ran * NICE_0_WEIGHT /
+                                       s->jobs[i].weight;
+        }
+        if (state == 0)
+            s->charged_remaining = s->remaining[i];
+        //a blocked job does not count towards the load of cfs either
+        if ((state == 2 || state == 3) && alg == CFS)
+            s->cfs_load -= s->jobs[i].weight;
+        if (s->state[i] == 3 && alg == CFS)
+            s->cfs_load += s->jobs[i].weight;
+    }
+    if (s->state[i] == 1 && state != 1)
+        ready_leave(s, i);
+    else if (s->state[i] != 1 && state == 1)
+        ready_enter(s, i);
+#ifdef PROFILE
+    if (state == 0 && s->state[i] != 0)
+        PROF_COUNT(PC_DISPATCHES);
+    if (state == 1 && s->state[i] == 0)
+        PROF_COUNT(PC_PREEMPTIONS);
+#endif
+    if (s->state[i] != state)
+        record(s, s->clock_usec, state == 0 ? REC_DISPATCH :
+                                 state == 2 ? REC_COMPLETE :
+                                 state == 3 ? REC_BLOCK :
+                                 s->state[i] == 3 ? REC_WAKE : REC_PREEMPT, i);
+    s->state[i] = state;
+}
+//adds the times of a finished job after the warm-up to the statistics,
+//t holds the response, turnaround and waiting time
+static void measure(struct Simulation *s, const int64_t *t)
+{
+    stats_add(&s->response, t[0]);
+    stats_add(&s->turnaround, t[1]);
+    stats_add(&s->waiting, t[2]);
+    bool full = false;
+    for (int k = 0; k < 3; ++k)
+        full = batch_add(&s->batches[k], t[k]);
+    if (!full || s->sp->ci_target <= 0 || s->batches[0].n < N_BATCHES / 2)
+        return;
+    s->converged = true;
+    for (int k = 0; k < 3; ++k)
+    {
+        double mean, half_width;
+        batch_ci(&s->batches[k], &mean, &half_width);
+        if (half_width > s->sp->ci_target * mean)
+            s->converged = false;
+    }
+}
+//ends the warm-up after the first w jobs, the ones kept since are measured
+static void end_warmup(struct Simulation *s, int64_t w)
+{
+    s->warmup = w;
+    for (int64_t i = w; i < s->seen; ++i)
+        measure(s, &s->early[3 * i]);
+    free(s->early);
+    s->early = NULL;
+}
+//hands the times of a finished job to the statistics; while the warm-up
+//is detected they are kept, and mser-5 is tried each time their number
+//doubles, so that costs O(1) per job
+static void record_job(struct Simulation *s, int64_t response,
+                       int64_t turnaround, int64_t waiting)
+{
+    if (s->parent)
+    {
+        record_job(s->parent, response, turnaround, waiting);
+        return;
+    }
+    int64_t t[3] = {response, turnaround, waiting};
+    int64_t i = s->seen++;
+    if (s->warmup >= 0)
+    {
+        if (i >= s->warmup)
+            measure(s, t);
+        return;
+    }
+    if (i == s->early_cap)
+    {
+        s->early_cap = s->early_cap ? s->early_cap * 2 : 64 * MSER_BATCH;
+        s->early = realloc(s->early, 3 * s->early_cap * sizeof(int64_t));
+    }
+    memcpy(&s->early[3 * i], t, sizeof(t));
+    if (s->seen < s->early_cap)
+        return;
+    //the longest of the three, unless one is in the second half, where the
+    //run is too short to tell yet
+    int64_t w = 0;
+    for (int k = 0; k < 3; ++k)
+    {
+        int64_t d = mser5(&s->early[k], s->seen, 3);
+        if (d > w)
+            w = d;
+    }
+    if (w <= s->seen / 2)
+        end_warmup(s, w);
+}
+//adds how late a job with a deadline finished, negative if in time
+static void record_deadline(struct Simulation *s, int64_t late)
+{
+    if (s->parent)
+        s = s->parent;
+    stats_add(&s->tardiness, late > 0 ? late : 0);
+    s->missed += late > 0;
+}
+//hands out a job slot, reusing the ones of finished jobs first
+static int alloc_job(struct Simulation *s)
+{
+    if (s->free_count > 0)
+        return s->free_slots[--s->free_count];
+    if (s->job_count == s->job_cap)
+    {
+        s->job_cap = s->job_cap ? s->job_cap * 2 : 64;
+        s->jobs = realloc(s->jobs, s->job_cap * sizeof(struct Job));
+        s->state = realloc(s->state, s->job_cap * sizeof(signed char));
+        s->remaining = realloc(s->remaining, s->job_cap * sizeof(int64_t));
+        s->ready_since = realloc(s->ready_since,
+                                 s->job_cap * sizeof(int64_t));
+        s->heap_pos = realloc(s->heap_pos, s->job_cap * sizeof(int));
+        s->level = realloc(s->level, s->job_cap * sizeof(signed char));
+        s->used = realloc(s->used, s->job_cap * sizeof(int));
+        s->io_at = realloc(s->io_at, s->job_cap * sizeof(int64_t));
+        s->free_slots = realloc(s->free_slots, s->job_cap * sizeof(int));
+        if (s->sp->sched_alg == LOTTERY)
+            ticket_grow(&s->tickets, s->job_cap);
+    }
+    return s->job_count++;
+}
+//the next job of the workload
+static void next_job(struct Simulation *s, int64_t *time,
+                     int64_t *compute_time)
+{
+    PROF_BEGIN(PH_ARRIVALS);
+    const struct simulation_params *sp = s->sp;
+    const struct Workload *w = sp->replay;
+    int64_t k = s->trace_next++;
+    if (w)
+    {
+        //no more arrivals once the file is used up
+        *time = k < w->n ? w->arrival[k] : INT64_MAX;
+        *compute_time = k < w->n ? w->compute_time[k] : 1;
+        if (*compute_time < 1)
+            *compute_time = 1;
+    }
+    else if (s->trace)
+        trace_get(s->trace, k, time, compute_time);
+    else
+        source_next(&s->source, time, compute_time);
+    //the file's priority and deadline, else generated ones; the priority
+    //comes from the number of the job, not from the random stream, so the
+    //jobs stay the same whatever is generated
+    if (w && w->priority)
+        s->next_priority = k < w->n ? w->priority[k] : 0;
+    else
+        s->next_priority = sp->priorities > 0 ?
+                (int)(mix64(sp->seed ^ mix64((uint64_t)k)) %
+                      (uint64_t)sp->priorities) : 0;
+    if (w && w->deadline)
+        s->next_deadline = k < w->n ? w->deadline[k] : 0;
+    else
+        s->next_deadline = (int64_t)(sp->deadline * (double)*compute_time);
+    PROF_END();
+}
+//the job of a new arrival, before it is placed on a cpu
+static struct Migrant new_job(struct Simulation *s, int64_t time,
+                              int64_t compute_time)
+{
+    PROF_COUNT(PC_ARRIVALS);
+    int bursts = s->sp->io_bursts;
+    struct Migrant m = {.job = getJob(time, compute_time),
+                        .remaining = compute_time};
+    //the cpu time is cut into one burst more than the i/o bursts, the last
+    //one may be shorter
+    m.job.burst = (compute_time + bursts) / (bursts + 1);
+    m.io_at = bursts > 0 ? compute_time - m.job.burst : 0;
+    m.job.id = s->next_id++;
+    m.job.priority = s->next_priority;
+    m.job.deadline = s->next_deadline > 0 ? time + s->next_deadline :
+                     INT64_MAX;
+    m.job.tenant = m.job.id % s->sp->tenants;
+    m.job.tickets = s->sp->tickets[m.job.tenant];
+    m.job.weight = s->sp->sched_alg == STRIDE ? m.job.tickets :
+                   cfs_weight(s->next_priority);
+    return m;
+}
+//puts a job into a slot as a waiting one, returns the slot
+static int place_job(struct Simulation *s, const struct Migrant *m)
+{
+    int i = alloc_job(s);
+    s->jobs[i] = m->job;
+    if (s->sp->sched_alg == CFS || s->sp->sched_alg == STRIDE)
+        s->jobs[i].vruntime += s->min_vruntime;
+    if (s->sp->sched_alg == CFS)
+        s->cfs_load += s->jobs[i].weight;
+    s->state[i] = 1;
+    s->remaining[i] = m->remaining;
+    s->heap_pos[i] = -1;
+    s->level[i] = (signed char)m->level;
+    s->io_at[i] = m->io_at;
+    s->used[i] = 0;
+    ready_enter(s, i);
+    return i;
+}
+//adds a new waiting job at the current time, returns its slot
+static int add_job(struct Simulation *s, int64_t time, int64_t compute_time)
+{
+    struct Migrant m = new_job(s, time, compute_time);
+    int i = place_job(s, &m);
+    s->n_jobs++;
+    record(s, time, REC_ARRIVAL, i);
+    D_PRNT("t=%ld,job %d is added, needing %ld usec\n",time,
+           i, s->jobs[i].compute_time);
+    return i;
+}
+//switches to another job, the slot of the old one is given back if it is
+//finished since its statistics are already added up
+static void set_current(struct Simulation *s, int i)
+{
+    if (s->state[s->current_job_index] == 2)
+        s->free_slots[s->free_count++] = s->current_job_index;
+    s->current_job_index = i;
+}
+//starts the scheduler at the current time
+static void start_scheduler(struct Simulation *s)
+{
+    PROF_COUNT(PC_SCHEDULER);
+    s->scheduler_running = true;
+    s->scheduler_start_time = s->clock_usec;
+    record(s, s->clock_usec, REC_SCHEDULER, -1);
+    if (s->sp->sched_time > 0)
+        wheel_add(&s->events, s->clock_usec + s->sp->sched_time,
+                  EV_SCHED_DONE, -1);
+}
+//starts a context switch that begins at start
+static void start_context_switch(struct Simulation *s, int64_t start)
+{
+    PROF_COUNT(PC_CONTEXT_SWITCHES);
+    s->context_switch_running = true;
+    s->cs_start_time = start;
+    record(s, start, REC_CONTEXT_SWITCH, -1);
+    if (start + s->sp->cont_swtch_time > s->clock_usec)
+        wheel_add(&s->events, start + s->sp->cont_swtch_time, EV_CS_DONE, -1);
+}
+//true if the current job just keeps running until the next event,
+//i.e. every usec in between looks exactly the same
+static bool cpu_busy(const struct Simulation *s)
+{
+    return !s->scheduler_running && !s->context_switch_running &&
+           s->state[s->current_job_index] == 0;
+}
+//true if no job runs or waits, the current one is finished or blocked
+static bool cpu_idle(const struct Simulation *s)
+{
+    return s->state[s->current_job_index] >= 2 && s->n_waiting == 0;
+}
+//moves the clock to time, accounting in one go for the usecs in between
+static void advance(struct Simulation *s, int64_t time)
+{
+    int64_t skipped = time - s->clock_usec - 1;
+    if (skipped > 0 && cpu_busy(s))
+    {
+        s->remaining[s->current_job_index] -= skipped;
+        s->jobs[s->current_job_index].turnaround_time += skipped;
+        s->ready_clock += skipped;
+        s->busy_usec += skipped;
+    }
+    else if (skipped > 0 && cpu_idle(s))
+        s->idle_usec += skipped;
+    s->clock_usec = time;
+}
+//clock ticks and runs the scheduler
+static void handle_tick(struct Simulation *s)
+{
+    int64_t clock_usec = s->clock_usec;
+    //an idle cpu of several stops ticking until a job is sent to it
+    if (s->parent && s->n_jobs == 0)
+    {
+        s->tickless = true;
+        return;
+    }
+    s->tick = true;
+    PROF_COUNT(PC_TICKS);
+    record(s, clock_usec, REC_TICK, -1);
+    //if the current job is running, it is stopped
+    if (s->state[s->current_job_index]==0)
+    {
+        D_PRNT("t=%ld,clock ticks,current running process %d stops\n",
+               clock_usec,s->current_job_index);
+        set_state(s, s->current_job_index, 1);
+    }
+    if (s->context_switch_running&&s->cs_start_time<clock_usec)
+        s->context_switch_running = false;
+    start_scheduler(s);
+    wheel_add(&s->events, clock_usec + s->sp->tick_time*1000, EV_TICK, -1);
+}
+//the preemptive algorithms that run the least key, srtf, edf and pprio: a
+//job that arrives with a smaller key than the running one (needing less
+//than what is left of it, due earlier or more urgent) stops it and the
+//scheduler runs as if the clock had ticked, so the heap hands it the cpu;
+//jobs that arrive while the scheduler or a context switch is going on are
+//weighed when the scheduler finishes or at the next tick
+static bool preempts(enum sched_alg_T alg)
+{
+    return alg == SRTF || alg == EDF || alg == PPRIO;
+}
+static void preempt_arrival(struct Simulation *s, int i)
+{
+    int cur = s->current_job_index;
+    if (!cpu_busy(s) || ready_key(s, i) >= ready_key(s, cur))
+        return;
+    D_PRNT("t=%ld,job %d preempts process %d\n", s->clock_usec, i, cur);
+    set_state(s, cur, 1);
+    start_scheduler(s);
+}
+//length of the next i/o burst of a job, exponential with a mean of io_time
+//msec; drawn from the number of the job and the burst, not from the
+//random stream, so every algorithm sees the same bursts
+static int64_t io_length(const struct simulation_params *sp,
+                         const struct Job *j)
+{
+    uint64_t h = mix64(sp->seed ^ mix64(((uint64_t)j->id << 20) +
+                                        (uint64_t)j->io_done));
+    double u = (double)((h >> 11) + 1) * 0x1p-53;
+    return (int64_t)(-log(u) * sp->io_time * 1000) + 1;
+}
+//the current job ran its burst and blocks on i/o until the usec after its
+//burst ends; the time it is blocked counts in its turnaround time
+static void start_io(struct Simulation *s, int i)
+{
+    struct Job *j = &s->jobs[i];
+    int64_t length = io_length(s->sp, j);
+    PROF_COUNT(PC_BLOCKS);
+    j->io_done++;
+    j->turnaround_time += length;
+    s->io_at[i] = s->io_at[i] > j->burst ? s->io_at[i] - j->burst : 0;
+    set_state(s, i, 3);
+    wheel_add(&s->events, s->clock_usec + length + 1, EV_IO_DONE, i);
+    D_PRNT("t=%ld,process %d blocks for %ld usec\n", s->clock_usec, i,
+           length);
+}
+//the i/o of job i ends, it waits for the cpu again like a new arrival;
+//cfs and stride do not let it keep a vruntime from long ago
+static void end_io(struct Simulation *s, int i)
+{
+    enum sched_alg_T alg = s->sp->sched_alg;
+    if ((alg == CFS || alg == STRIDE) && s->jobs[i].vruntime < s->min_vruntime)
+        s->jobs[i].vruntime = s->min_vruntime;
+    set_state(s, i, 1);
+    if (preempts(alg))
+        preempt_arrival(s, i);
+}
+//job i gets the cpu from the scheduler that started at
+//scheduler_start_time; its response time is set the first time it is
+//picked, and the context switch starts if it is not the previous job
+static void pick(struct Simulation *s, int i)
+{
+    struct Job *j = &s->jobs[i];
+    set_current(s, i);
+    if (j->new)
+    {
+        j->response_time = s->scheduler_start_time - j->generated;
+        j->new = false;
+    }
+    if (i != s->previous_job_index)
+        start_context_switch(s, s->scheduler_start_time + s->sp->sched_time);
+}
+//special handling for rr, the current job goes to the back of the run queue
+//and the one at the front is picked
+static void rr_select(struct Simulation *s)
+{
+    s->previous_job_index = s->current_job_index;
+    if (s->state[s->current_job_index]==1)
+        rq_push(&s->run_queue, s->current_job_index);
+    if (s->run_queue.count == 0)
+        return;
+    pick(s, rq_pop(&s->run_queue));
+}
+//mlfq: every job goes back to the top level with a fresh quantum, the
+//lower levels are emptied into the top one in order; this is O(jobs) but
+//only happens every mlfq_boost msec; the next boost is at the first
+//period boundary after now, so a cpu that was idle for several periods
+//boosts once and not at each of its next picks
+static void mlfq_boost(struct Simulation *s)
+{
+    const struct simulation_params *sp = s->sp;
+    int64_t period = (int64_t)sp->mlfq_boost * 1000;
+    for (int l = 1; l < sp->mlfq_levels; ++l)
+        while (s->levels[l].count > 0)
+        {
+            int i = mlfq_pop(s, l);
+            s->level[i] = 0;
+            s->used[i] = 0;
+            mlfq_push(s, i, false);
+        }
+    s->level[s->current_job_index] = 0;
+    s->used[s->current_job_index] = 0;
+    s->next_boost += ((s->clock_usec - s->next_boost) / period + 1) * period;
+}
+//mlfq, at a tick or when the current job finishes: a job stopped by the
+//tick is moved a level down once it has used up the quantum of its level,
+//goes back in front of its level if a higher one has jobs waiting and
+//else just keeps running; then the first job of the top level that has
+//any gets the cpu, all in O(1) whatever the number of levels
+static void mlfq_select(struct Simulation *s)
+{
+    const struct simulation_params *sp = s->sp;
+    struct Job *jobs = s->jobs;
+    int cur = s->current_job_index;
+    s->previous_job_index = cur;
+    if (sp->mlfq_boost > 0 && s->clock_usec >= s->next_boost)
+        mlfq_boost(s);
+    if (s->state[cur] == 1)
+    {
+        int l = s->level[cur];
+        //the first job is current before it ever ran, it only queues
+        if (jobs[cur].new)
+            mlfq_push(s, cur, false);
+        else if (++s->used[cur] >= sp->mlfq_quanta[l])
+        {
+            if (l < sp->mlfq_levels - 1)
+                s->level[cur]++;
+            s->used[cur] = 0;
+            mlfq_push(s, cur, false);
+        }
+        else if (s->level_mask & (((uint64_t)1 << l) - 1))
+            mlfq_push(s, cur, true);
+        else
+            return;
+    }
+    if (s->level_mask == 0)
+        return;
+    pick(s, mlfq_pop(s, __builtin_ctzll(s->level_mask)));
+}
+//cfs, at a tick or when the current job finishes: like linux at a tick, a
+//job stopped by the tick keeps the cpu until it has run its share of the
+//period, and at least cfs_min_gran, unless it is ahead of the leftmost
+//job by more than that share; then the leftmost job, the one with the
+//least vruntime, gets the cpu, in O(log n) from the heap
+static void cfs_select(struct Simulation *s)
+{
+    const struct simulation_params *sp = s->sp;
+    struct Job *jobs = s->jobs;
+    int cur = s->current_job_index;
+    s->previous_job_index = cur;
+    if (s->ready.size == 0)
+        return;
+    int64_t leftmost = s->ready.e[0].key;
+    if (leftmost > s->min_vruntime)
+        s->min_vruntime = leftmost;
+    if (s->state[cur] == 1 && !jobs[cur].new)
+    {
+        //the runnable jobs, like nr_running: the waiting ones, the stopped
+        //current one among them; not the blocked ones nor those on their
+        //way to this cpu, as for cfs_load
+        int64_t runnable = s->n_waiting;
+        int64_t period = runnable * sp->cfs_min_gran > sp->cfs_latency ?
+                         runnable * sp->cfs_min_gran : sp->cfs_latency;
+        int64_t share = period * jobs[cur].weight / s->cfs_load;
+        int64_t ran = s->picked_remaining - s->remaining[cur];
+        if (ran <= share && (ran < sp->cfs_min_gran ||
+                             jobs[cur].vruntime - leftmost <= share))
+            return;
+    }
+    pick(s, s->ready.e[0].job);
+    s->picked_remaining = s->remaining[s->current_job_index];
+}
+//lottery, at a tick or when the current job finishes: one of the tickets
+//of the waiting jobs, the stopped one included, is drawn and its job gets
+//the cpu, in O(log n) from the ticket tree
+static void lottery_select(struct Simulation *s)
+{
+    s->previous_job_index = s->current_job_index;
+    if (s->tickets.total == 0)
+        return;
+    uint64_t r = rng_next(&s->sched_rng) % (uint64_t)s->tickets.total;
+    pick(s, ticket_find(&s->tickets, (int64_t)r));
+}
+//stride, at a tick or when the current job finishes: the job with the
+//least pass gets the cpu; a job's pass grows by the usecs it runs over its
+//tickets, so each one runs in proportion to its tickets; new jobs start
+//at the least pass, like vruntime in cfs
+static void stride_select(struct Simulation *s)
+{
+    s->previous_job_index = s->current_job_index;
+    if (s->ready.size == 0)
+        return;
+    if (s->ready.e[0].key > s->min_vruntime)
+        s->min_vruntime = s->ready.e[0].key;
+    pick(s, s->ready.e[0].job);
+}
+//picks the next job for the algorithms that pick at every tick
+static void tick_select(struct Simulation *s)
+{
+    switch (s->sp->sched_alg)
+    {
+        case RR: rr_select(s); break;
+        case MLFQ: mlfq_select(s); break;
+        case CFS: cfs_select(s); break;
+        case LOTTERY: lottery_select(s); break;
+        case STRIDE: stride_select(s); break;
+        default: break;
+    }
+}
+//runs the scheduler, the context switch, the current job and the dispatcher
+//for the usec at clock_usec, after all the events at that time are handled
+static void run_usec(struct Simulation *s)
+{
+    const struct simulation_params *sp = s->sp;
+    struct Job *jobs = s->jobs;
+    signed char *state = s->state;
+    int64_t *remaining = s->remaining;
+    int64_t clock_usec = s->clock_usec;
+
+    if (cpu_idle(s))
+        s->idle_usec++;
+    if (s->tick)
+        tick_select(s);
+    s->tick = false;
+    //scheduler is running
+    if (s->scheduler_running)
+    {
+        if (clock_usec != s->scheduler_start_time + sp->sched_time)
+            return;
+        else
+        {
+            s->scheduler_running = false;//scheduler finish
+            //D_PRNT("t=%ld,scheduler done\n",clock_usec);
+        }
+    }
+    //context switch is running
+    if (s->context_switch_running &&clock_usec != s->cs_start_time + sp
+            ->cont_swtch_time)
+    {
+        return;
+    }
+    if (clock_usec == s->cs_start_time + sp->cont_swtch_time) {
+        s->context_switch_running = false;//cs finish
+        //D_PRNT("t=%ld,context switch done\n",clock_usec);
+    }
+    int cur = s->current_job_index;
+    //from here on, a current job that is finished or blocked (state 2 or
+    //3) has left the cpu and the next one is picked
+    if (state[cur]>=2&&sp->sched_alg==FCFS)
+    {
+        if (s->run_queue.count == 0)
+            return;
+    }
+    //if the current job is running
+    if (state[cur]==0)
+    {
+        //increment time count
+        remaining[cur]--;
+        jobs[cur].turnaround_time++;
+        s->busy_usec++;
+        //if at current time the job finishes
+        if (remaining[cur] ==0)
+        {
+            //current job finishes
+            set_state(s, cur, 2);
+            s->finished_jobs++;
+            if (--s->n_jobs == 0 && s->parent)
+                s->parent->idle_cpus++;
+            //adds to statistics
+            PROF_BEGIN(PH_STATS);
+            if (jobs[cur].deadline != INT64_MAX)
+                record_deadline(s, clock_usec + 1 - jobs[cur].deadline);
+            record_job(s, jobs[cur].response_time,
+                       jobs[cur].turnaround_time, jobs[cur].wait_time);
+            PROF_END();
+            s->previous_job_index = cur;
+            D_PRNT("t=%ld,process %d finished\n", clock_usec, cur);
+            D_PRNT("job %d respond=%ld,wait=%ld,turnaround=%ld\n",
+                   cur,jobs[cur].response_time,jobs[cur].wait_time,
+                   jobs[cur].turnaround_time);
+        }
+        else if (remaining[cur] == s->io_at[cur])
+        {
+            start_io(s, cur);
+            s->previous_job_index = cur;
+        }
+    }
 
-            int tmp = current_job_index;
-            //job finish
-            if (jobs[current_job_index].state==2)
+    if (sp->sched_alg == FCFS)
+    {
+        //FCFS
+        if (state[cur] == 1)
+        {
+            set_state(s, cur, 0);
+            D_PRNT("t=%ld,dispatching process %d,needing %ld usec\n",
+                   s->scheduler_start_time, cur, jobs[cur].compute_time);
+        }
+        if (state[cur] >= 2 && s->run_queue.count > 0)
+        {
+            //previous job finished and there are jobs left
+            set_current(s, rq_pop(&s->run_queue));
+            cur = s->current_job_index;
+            //runs scheduler at next usec
+            start_scheduler(s);
+            //runs context switch after the scheduler finish
+            start_context_switch(s, s->scheduler_start_time + sp->sched_time);
+            if (jobs[cur].new)
             {
-                previous_job_index = current_job_index;
-                //runs scheduler at next usec
-                scheduler_running = true;
-                scheduler_start_time = clock_usec;
-                //runs context switch after the scheduler finish
-                context_switch_running = true;
-                cs_start_time = scheduler_start_time + sim_params.sched_time;
-                current_job_index = shortest(jobs,job_count);
-                jobs[current_job_index] .response_time = scheduler_start_time -
-                        jobs[current_job_index].generated;
-                continue;
-            }
-            if (!job_scheduled)
+                jobs[cur].response_time = s->scheduler_start_time -
+                        jobs[cur].generated;
+                jobs[cur].wait_time = jobs[cur].response_time;
+                jobs[cur].new = false;
+            }
+            return;
+        }
+    }
+    if (runs_least(sp->sched_alg))
+    {
+        if (state[cur]==1)
+            s->job_scheduled = false;
+
+        //job finish
+        if (state[cur]>=2)
+        {
+            //nothing to run, wait for a new job
+            if (s->ready.size == 0)
+                return;
+            s->previous_job_index = cur;
+            //runs scheduler at next usec
+            start_scheduler(s);
+            //runs context switch after the scheduler finish
+            start_context_switch(s, s->scheduler_start_time + sp->sched_time);
+            set_current(s, s->ready.e[0].job);
+            //sjf counts from the last time a job is picked this way before
+            //its first i/o, the others from the first time it is picked
+            if ((sp->sched_alg == SJF &&
+                 jobs[s->current_job_index].io_done == 0) ||
+                jobs[s->current_job_index].new)
+                jobs[s->current_job_index].response_time =
+                        s->scheduler_start_time -
+                        jobs[s->current_job_index].generated;
+            jobs[s->current_job_index].new = false;
+            return;
+        }
+        if (!s->job_scheduled)
+        {
+            //non-preemptive prio keeps the job it picked until it is done
+            if (sp->sched_alg != PRIO || state[cur] != 1 || jobs[cur].new)
+                set_current(s, s->ready.e[0].job);
+            if (sp->sched_alg != SJF && jobs[s->current_job_index].new)
             {
-                current_job_index = shortest(jobs,job_count);
-                D_PRNT("t=%ld,dispatching process %d,needing %ld usec\n job "
-                       "finished:%d\n",
-                       scheduler_start_time, current_job_index,
-                       jobs[current_job_index].remaining,finished_jobs);
-                job_scheduled = true;
-                if (current_job_index!=tmp)
-                {
-                    context_switch_running = true;
-                    cs_start_time = scheduler_start_time + sim_params.sched_time+1;
-                }
+                jobs[s->current_job_index].response_time =
+                        s->scheduler_start_time -
+                        jobs[s->current_job_index].generated;
+                jobs[s->current_job_index].new = false;
             }
-            jobs[current_job_index].state = 0;//start the job
+            D_PRNT("t=%ld,dispatching process %d,needing %ld usec\n job "
+                   "finished:%d\n",
+                   s->scheduler_start_time, s->current_job_index,
+                   remaining[s->current_job_index],s->finished_jobs);
+            s->job_scheduled = true;
+            if (s->current_job_index!=cur)
+                start_context_switch(s, s->scheduler_start_time +
+                                        sp->sched_time+1);
+        }
+        set_state(s, s->current_job_index, 0);//start the job
+
+    }
+    if (sp->sched_alg != FCFS && !runs_least(sp->sched_alg)) {
+        if (state[cur] == 1)
+        {
+            set_state(s, cur, 0);
+            D_PRNT("t=%ld,dispatching process %d,needing %ld usec\n",
+                   s->scheduler_start_time, cur, remaining[cur]);
+        }
+        if (state[cur] >= 2)
+        {
+            //nothing to run, wait for a new job
+            if (s->n_waiting == 0)
+                return;
+            //runs scheduler, it picks the next job right away
+            start_scheduler(s);
+            tick_select(s);
+            return;
 
         }
-        if (sim_params.sched_alg == RR) {
-            if (jobs[current_job_index].state == 1)
+    }
+    //count the wait and turnaround time for the process in the queue
+    //note if the scheduler or context switch is going on, it won't get here
+    if (!s->context_switch_running)
+        s->ready_clock++;
+}
+//sets up a run whose jobs are read from trace if it is not NULL, and
+//whose events go to recorder as the given run if that is not NULL
+static void sim_init(struct Simulation *s, const struct simulation_params *sp,
+                     struct Trace *trace, struct Recorder *recorder, int run)
+{
+    memset(s, 0, sizeof(*s));
+    s->sp = sp;
+    s->recorder = recorder;
+    s->run = run;
+    if (recorder)
+        s->records = malloc(RECORD_BLOCK * sizeof(struct EventRecord));
+    s->clock_usec = -1;
+    s->trace = trace;
+    s->warmup = sp->warmup;
+    if (sp->sched_alg == MLFQ)
+    {
+        s->levels = calloc(sp->mlfq_levels, sizeof(struct RunQueue));
+        s->next_boost = (int64_t)sp->mlfq_boost * 1000;
+    }
+    if (!trace)
+        source_init(&s->source, sp);
+    rng_seed(&s->sched_rng, ~sp->seed);
+}
+//a job sent to this cpu joins it
+static void adopt_job(struct Simulation *s)
+{
+    struct Migrant m = inbox_pop(&s->inbox);
+    int i = place_job(s, &m);
+    if (!m.migrated)
+        record(s, s->clock_usec, REC_ARRIVAL, i);
+    if (preempts(s->sp->sched_alg))
+        preempt_arrival(s, i);
+    //the clock ticks again from the next tick on
+    if (s->tickless)
+    {
+        int64_t tick = (int64_t)s->sp->tick_time * 1000;
+        s->tickless = false;
+        wheel_add(&s->events, (s->clock_usec / tick + 1) * tick, EV_TICK,
+                  -1);
+    }
+}
+//handles the next event, then runs the usec at its time once all the
+//events at that time are handled; returns true if it did
+static bool sim_step(struct Simulation *s)
+{
+    const struct simulation_params *sp = s->sp;
+    int64_t time;
+    struct Event ev = wheel_pop(&s->events);
+    PROF_COUNT(PC_EVENTS);
+    s->n_events++;
+    if (ev.time > s->clock_usec)
+        advance(s, ev.time);
+    if (ev.type == EV_IO_DONE)
+        end_io(s, ev.job);
+    else if (ev.type == EV_TICK)
+        handle_tick(s);
+    else if (ev.type == EV_ARRIVAL && s->parent)
+        adopt_job(s);
+    else if (ev.type == EV_ARRIVAL)
+    {
+        int i = add_job(s, s->clock_usec, s->next_compute_time);
+        if (preempts(sp->sched_alg))
+            preempt_arrival(s, i);
+        next_job(s, &time, &s->next_compute_time);
+        wheel_add(&s->events, time, EV_ARRIVAL, -1);
+    }
+    //the other events only wake the simulation up
+    if (wheel_next(&s->events) == s->clock_usec)
+        return false;
+    PROF_BEGIN(PH_SCHEDULE);
+    run_usec(s);
+    PROF_END();
+    //the current job runs by itself until it finishes or blocks on i/o,
+    //unless something interrupts it
+    int cur = s->current_job_index;
+    if (cpu_busy(s) && s->remaining[cur] > s->io_at[cur])
+        wheel_add(&s->events, s->clock_usec + s->remaining[cur] -
+                  s->io_at[cur], EV_JOB_DONE, -1);
+    return true;
+}
+//ends a run, the statistics are all that is kept
+static void sim_end(struct Simulation *s)
+{
+    const struct simulation_params *sp = s->sp;
+    //mser-5 never settled, the run is too short or has no steady state at
+    //all (more work arrives than the cpu can do), so half of it is dropped
+    if (s->warmup < 0)
+    {
+        s->no_steady_state = true;
+        end_warmup(s, s->seen / 2);
+    }
+    if (s->recorder)
+        recorder_write(s->recorder, s->run, s->records, s->n_records);
+    free(s->records);
+    free(s->events.ev);
+    free(s->events.link);
+    free(s->ready.e);
+    free(s->run_queue.idx);
+    free(s->jobs);
+    free(s->state);
+    free(s->remaining);
+    free(s->ready_since);
+    free(s->heap_pos);
+    free(s->level);
+    free(s->used);
+    free(s->io_at);
+    for (int l = 0; s->levels && l < sp->mlfq_levels; ++l)
+        free(s->levels[l].idx);
+    free(s->levels);
+    free(s->free_slots);
+    free(s->inbox.m);
+    free(s->tickets.sum);
+    s->jobs = NULL;
+}
+//with -cpus: the time of the next event of a cpu, INT64_MAX for an idle
+//one that stopped ticking
+static int64_t cpu_next(const struct Simulation *c)
+{
+    return wheel_next(&c->events);
+}
+//sends a job to cpu c, it joins it at time
+static void send_job(struct Simulation *c, const struct Migrant *m,
+                     int64_t time)
+{
+    inbox_push(&c->inbox, m);
+    if (c->n_jobs++ == 0)
+        c->parent->idle_cpus--;
+    wheel_add(&c->events, time, EV_ARRIVAL, -1);
+}
+//the jobs of c that can move to another cpu, the waiting ones but the
+//current job
+static int movable(const struct Simulation *c)
+{
+    return c->n_waiting - (c->state[c->current_job_index] == 1);
+}
+//takes a waiting job off c to move it: the last one of the run queue, of
+//the lowest mlfq level or of the heap, so one that would not run soon
+//anyway; -1 if there is none
+static int take_waiting(struct Simulation *c)
+{
+    enum sched_alg_T alg = c->sp->sched_alg;
+    int i = -1;
+    if (alg == FCFS || alg == RR)
+    {
+        if (c->run_queue.count > 0)
+            i = rq_pop_back(&c->run_queue);
+    }
+    else if (alg == LOTTERY)
+    {
+        //the first job that holds tickets, or the next one if that is the
+        //current job
+        int cur = c->current_job_index;
+        if (c->tickets.total > 0)
+            i = ticket_find(&c->tickets, 0);
+        if (i == cur)
+            i = c->tickets.total > c->jobs[cur].tickets ?
+                ticket_find(&c->tickets, c->jobs[cur].tickets) : -1;
+    }
+    else if (alg == MLFQ)
+    {
+        if (c->level_mask)
+        {
+            int l = 63 - __builtin_clzll(c->level_mask);
+            i = rq_pop_back(&c->levels[l]);
+            if (c->levels[l].count == 0)
+                c->level_mask &= ~((uint64_t)1 << l);
+        }
+    }
+    else
+    {
+        //the current job is in the heap too, one of the last two is not it
+        for (int k = c->ready.size - 1; k >= 0 && k >= c->ready.size - 2; --k)
+            if (c->ready.e[k].job != c->current_job_index)
             {
-                jobs[current_job_index].state = 0;
-                D_PRNT("t=%ld,dispatching process %d,needing %ld usec\n",
-                       scheduler_start_time, current_job_index,
-                       jobs[current_job_index].remaining);
+                i = c->ready.e[k].job;
+                break;
             }
-            if (jobs[current_job_index].state == 2)
+    }
+    if (i >= 0)
+        ready_leave(c, i);
+    return i;
+}
+//moves a waiting job from cpu v to cpu d at time t, it gets there a usec
+//later; false if v has none to give
+static bool migrate(struct Simulation *v, struct Simulation *d, int64_t t)
+{
+    //v catches up to just before t first, so the job is charged for the
+    //time it waited there
+    if (v->clock_usec < t - 1)
+    {
+        advance(v, t);
+        v->clock_usec = t - 1;
+    }
+    int i = take_waiting(v);
+    if (i < 0)
+        return false;
+    struct Migrant m = {.job = v->jobs[i], .remaining = v->remaining[i],
+                        .io_at = v->io_at[i],
+                        .level = v->level[i], .migrated = true};
+    if (v->sp->sched_alg == CFS || v->sp->sched_alg == STRIDE)
+        m.job.vruntime -= v->min_vruntime;
+    if (v->sp->sched_alg == CFS)
+        v->cfs_load -= m.job.weight;
+    record(v, t, REC_MIGRATE, i);
+    v->state[i] = 2;
+    v->free_slots[v->free_count++] = i;
+    if (--v->n_jobs == 0)
+        v->parent->idle_cpus++;
+    v->migrated_out++;
+    d->migrated_in++;
+    send_job(d, &m, t + 1);
+    return true;
+}
+//the cpus in the order of their next events
+struct CpuOrder {
+    struct JobHeap heap;
+    int *pos;
+};
+static void order_update(struct CpuOrder *o, struct Simulation *cpus, int c)
+{
+    heap_update(&o->heap, o->pos, c, cpu_next(&cpus[c]));
+}
+//steal balancing, after cpu c ran a usec: if it is idle it takes a job
+//from the cpu with the most waiting, else if it has jobs waiting and
+//another cpu is idle it gives it one
+static void steal(struct Simulation *cpus, int n, int c, struct CpuOrder *o)
+{
+    struct Simulation *cpu = &cpus[c];
+    int64_t t = cpu->clock_usec;
+    if (cpu->n_jobs == 0)
+    {
+        int v = -1, most = 0;
+        for (int k = 0; k < n; ++k)
+            if (movable(&cpus[k]) > most)
             {
-                //runs scheduler
-                scheduler_running = true;
-                scheduler_start_time = clock_usec;
-                //runs context switch after the scheduler finish
-                context_switch_running = true;
-                cs_start_time = scheduler_start_time + sim_params.sched_time;
-                continue;
-
+                most = movable(&cpus[k]);
+                v = k;
+            }
+        if (v >= 0)
+            migrate(&cpus[v], cpu, t);
+    }
+    else if (cpu->parent->idle_cpus > 0 && movable(cpu) > 0)
+    {
+        for (int k = 0; k < n; ++k)
+            if (cpus[k].n_jobs == 0)
+            {
+                migrate(cpu, &cpus[k], t);
+                order_update(o, cpus, k);
+                break;
+            }
+    }
+}
+//push balancing at time t: jobs move from the cpu with the most to the
+//one with the fewest until they differ by one at most
+static void push_balance(struct Simulation *cpus, int n, int64_t t,
+                         struct CpuOrder *o)
+{
+    for (;;)
+    {
+        int hi = -1, lo = 0;
+        for (int k = 0; k < n; ++k)
+        {
+            if (movable(&cpus[k]) > 0 &&
+                (hi < 0 || cpus[k].n_jobs > cpus[hi].n_jobs))
+                hi = k;
+            if (cpus[k].n_jobs < cpus[lo].n_jobs)
+                lo = k;
+        }
+        if (hi < 0 || cpus[hi].n_jobs - cpus[lo].n_jobs <= 1 ||
+            !migrate(&cpus[hi], &cpus[lo], t))
+            return;
+        order_update(o, cpus, lo);
+    }
+}
+//with a global queue: cpu c takes the job that waited longest in the
+//queue of s at time if it has nothing to run or wait for; the time in the
+//queue counts as waiting; returns true if it did
+static bool take_global(struct Simulation *s, struct Simulation *c,
+                        int64_t time)
+{
+    if (s->inbox.count == 0 || c->inbox.count > 0 || !cpu_idle(c))
+        return false;
+    struct Migrant m = inbox_pop(&s->inbox);
+    int64_t waited = time - m.job.generated;
+    m.job.wait_time += waited;
+    m.job.turnaround_time += waited;
+    send_job(c, &m, time);
+    return true;
+}
+//a run with -cpus: every cpu is a simulation of its own that gets its
+//jobs from s, which keeps the statistics; the next thing to happen is
+//always done first, a new job before a balancing before the cpus at the
+//same time, so all of them see one clock
+static void simulate_cpus(const struct simulation_params *sp,
+                          struct Trace *trace, struct Recorder *recorder,
+                          int run, struct Simulation *s)
+{
+    int n = sp->cpus;
+    int64_t time, compute_time;
+    sim_init(s, sp, trace, recorder, run);
+    struct Simulation *cpus = malloc(n * sizeof(struct Simulation));
+    struct CpuOrder order = {.pos = malloc(n * sizeof(int))};
+    for (int c = 0; c < n; ++c)
+    {
+        struct Simulation *cpu = &cpus[c];
+        sim_init(cpu, sp, trace, NULL, run);
+        cpu->parent = s;
+        cpu->cpu = c;
+        cpu->warmup = 0; //the parent finds it
+        rng_seed(&cpu->sched_rng, ~sp->seed ^ (uint64_t)c << 32);
+        cpu->current_job_index = alloc_job(cpu);
+        cpu->state[cpu->current_job_index] = 2;
+        cpu->cs_start_time = sp->sched_time;
+        wheel_add(&cpu->events, 0, EV_TICK, -1);
+        heap_push(&order.heap, order.pos, c, 0);
+    }
+    s->idle_cpus = n;
+    int64_t interval = (int64_t)sp->balance_interval * 1000;
+    int64_t next_balance = sp->balance == BAL_PUSH ? interval : INT64_MAX;
+    int next_cpu = 0;
+    next_job(s, &time, &compute_time);
+    while (s->seen < sp->total_jobs && !s->converged)
+    {
+        int c = order.heap.e[0].job;
+        if (time <= order.heap.e[0].key && time <= next_balance)
+        {
+            //new jobs join the global queue and go to idle cpus in turn,
+            //else they are dealt out in turn
+            struct Migrant m = new_job(s, time, compute_time);
+            if (sp->balance == BAL_GLOBAL)
+            {
+                inbox_push(&s->inbox, &m);
+                for (int k = 0; k < n && s->inbox.count > 0; ++k)
+                {
+                    int d = (next_cpu + k) % n;
+                    if (!take_global(s, &cpus[d], time))
+                        continue;
+                    next_cpu = (d + 1) % n;
+                    order_update(&order, cpus, d);
+                }
+            }
+            else
+            {
+                int d = next_cpu;
+                next_cpu = (d + 1) % n;
+                send_job(&cpus[d], &m, time);
+                order_update(&order, cpus, d);
+            }
+            next_job(s, &time, &compute_time);
+        }
+        else if (next_balance <= order.heap.e[0].key)
+        {
+            PROF_BEGIN(PH_BALANCE);
+            push_balance(cpus, n, next_balance, &order);
+            PROF_END();
+            next_balance += interval;
+        }
+        else
+        {
+            bool ran = sim_step(&cpus[c]);
+            //a cpu that just ran out of jobs takes one from the global
+            //queue from the next usec on
+            if (ran && sp->balance == BAL_GLOBAL)
+                take_global(s, &cpus[c], cpus[c].clock_usec + 1);
+            if (ran && sp->balance == BAL_STEAL)
+            {
+                PROF_BEGIN(PH_BALANCE);
+                steal(cpus, n, c, &order);
+                PROF_END();
             }
+            order_update(&order, cpus, c);
+        }
+    }
+    s->n_cpus = n;
+    s->cpus = malloc(n * sizeof(struct CpuReport));
+    for (int c = 0; c < n; ++c)
+    {
+        struct CpuReport r = {
+                .busy_usec = cpus[c].busy_usec,
+                .idle_usec = cpus[c].idle_usec,
+                .end_usec = cpus[c].clock_usec,
+                .finished = cpus[c].finished_jobs,
+                .migrated_in = cpus[c].migrated_in,
+                .migrated_out = cpus[c].migrated_out
+        };
+        s->cpus[c] = r;
+        //the run as a whole lasts until the last cpu stopped
+        s->busy_usec += r.busy_usec;
+        s->idle_usec += r.idle_usec;
+        s->finished_jobs += r.finished;
+        s->n_events += cpus[c].n_events;
+        if (r.end_usec > s->clock_usec)
+            s->clock_usec = r.end_usec;
+        for (int k = 0; k < sp->tenants; ++k)
+            s->tenant_usec[k] += cpus[c].tenant_usec[k];
+        sim_end(&cpus[c]);
+    }
+    free(cpus);
+    free(order.heap.e);
+    free(order.pos);
+    sim_end(s);
+}
+//runs a whole simulation with the given parameters
+//the clock jumps from one event to the next instead of counting every usec,
+//so the running time depends on the number of events only
+//the jobs are read from trace if it is not NULL, and its events go to
+//recorder as the given run if that is not NULL
+void simulate(const struct simulation_params *sp, struct Trace *trace,
+              struct Recorder *recorder, int run, struct Simulation *s)
+{
+    int64_t time;
+    PROF_START();
+    if (sp->cpus > 1)
+    {
+        simulate_cpus(sp, trace, recorder, run, s);
+        PROF_SAVE(s);
+        return;
+    }
+    sim_init(s, sp, trace, recorder, run);
+    //initialize the jobs
+    for (int i = 0; i < sp->init_jobs; ++i)
+    {
+        next_job(s, &time, &s->next_compute_time);
+        add_job(s, time, s->next_compute_time);
+    }
+    //without jobs the cpu starts idle on a finished placeholder
+    if (sp->init_jobs == 0)
+    {
+        s->current_job_index = alloc_job(s);
+        s->state[s->current_job_index] = 2;
+    }
+    s->cs_start_time = sp->sched_time;
+    wheel_add(&s->events, 0, EV_TICK, -1);
+    //only the next arrival is ever in the queue
+    next_job(s, &time, &s->next_compute_time);
+    wheel_add(&s->events, time, EV_ARRIVAL, -1);
+    while (s->finished_jobs<sp->total_jobs && !s->converged)
+        sim_step(s);
+    sim_end(s);
+    PROF_SAVE(s);
+}
+//one simulation to run, a replication of one cell of a sweep
+struct Task {
+    struct simulation_params sp;
+    struct Trace *trace; //shared workload, NULL if it has its own
+    int cell;
+};
+//tasks owned by one worker, the owner takes them from the back and idle
+//workers steal from the front
+struct TaskDeque {
+    pthread_mutex_t lock;
+    int *task;
+    int head;
+    int tail;
+};
+struct TaskPool {
+    struct Task *tasks;
+    struct Simulation *runs; //results, one per task
+    int n_tasks;
+    struct TaskDeque *deques;
+    int n_workers;
+    struct Recorder *recorder; //NULL if nothing is recorded
+};
+struct Worker {
+    struct TaskPool *pool;
+    int id;
+};
+//next task for worker id, its own first, then stolen; -1 when all are taken
+static int take_task(struct TaskPool *pool, int id)
+{
+    for (int k = 0; k < pool->n_workers; ++k)
+    {
+        struct TaskDeque *d = &pool->deques[(id + k) % pool->n_workers];
+        int t = -1;
+        pthread_mutex_lock(&d->lock);
+        if (d->head < d->tail)
+            t = k == 0 ? d->task[--d->tail] : d->task[d->head++];
+        pthread_mutex_unlock(&d->lock);
+        if (t >= 0)
+            return t;
+    }
+    return -1;
+}
+void *task_worker(void *arg)
+{
+    struct Worker *w = arg;
+    int t;
+    while ((t = take_task(w->pool, w->id)) >= 0)
+    {
+        simulate(&w->pool->tasks[t].sp, w->pool->tasks[t].trace,
+                 w->pool->recorder, t, &w->pool->runs[t]);
+        w->pool->runs[t].sp = NULL;
+    }
+    return NULL;
+}
+//runs all tasks on a pool of threads, each simulation with its own random
+//stream, so the results do not depend on the number of threads
+void run_tasks(struct TaskPool *pool, int threads)
+{
+    pool->runs = calloc(pool->n_tasks, sizeof(struct Simulation));
+    pool->n_workers = threads < pool->n_tasks ? threads : pool->n_tasks;
+    pool->deques = calloc(pool->n_workers, sizeof(struct TaskDeque));
+    for (int i = 0; i < pool->n_workers; ++i)
+    {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+        pool->deques[i].task = malloc(pool->n_tasks * sizeof(int));
+    }
+    //deal the tasks out like cards
+    for (int t = 0; t < pool->n_tasks; ++t)
+    {
+        struct TaskDeque *d = &pool->deques[t % pool->n_workers];
+        d->task[d->tail++] = t;
+    }
+    struct Worker *workers = malloc(pool->n_workers * sizeof(struct Worker));
+    pthread_t *ids = malloc(pool->n_workers * sizeof(pthread_t));
+    for (int i = 0; i < pool->n_workers; ++i)
+    {
+        workers[i].pool = pool;
+        workers[i].id = i;
+        if (i > 0)
+            pthread_create(&ids[i], NULL, task_worker, &workers[i]);
+    }
+    task_worker(&workers[0]);
+    for (int i = 1; i < pool->n_workers; ++i)
+        pthread_join(ids[i], NULL);
+    for (int i = 0; i < pool->n_workers; ++i)
+    {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].task);
+    }
+    free(pool->deques);
+    free(workers);
+    free(ids);
+}
+//prints the mean of the n values with the half width of its 95% confidence
+//interval
+void print_ci(const char *name, const double *x, int n)
+{
+    double mean = 0, var = 0;
+    for (int i = 0; i < n; ++i)
+        mean += x[i] / n;
+    for (int i = 0; i < n; ++i)
+        var += (x[i] - mean) * (x[i] - mean) / (n - 1);
+    printf("    %-25s%10.6lf +- %.6lf\n", name, mean,
+           t_quantile_95(n - 1) * sqrt(var / n));
+}
+//prints the spread of the response, turnaround and waiting times, and of
+//the tardiness if any job had a deadline, then how many missed theirs
+void print_distribution(const struct Stats *response,
+                        const struct Stats *turnaround,
+                        const struct Stats *waiting,
+                        const struct Stats *tardiness, int64_t missed)
+{
+    const char *names[] = {"response", "turnaround", "waiting", "tardiness"};
+    const char *head[] = {"sd", "p50", "p95", "p99", "max"};
+    const struct Stats *st[] = {response, turnaround, waiting, tardiness};
+    int rows = tardiness->n > 0 ? 4 : 3;
+    double v[4][5];
+    char buf[32];
+    int w = 10;
+    for (int k = 0; k < rows; ++k)
+    {
+        v[k][0] = stats_sd(st[k]);
+        v[k][1] = stats_percentile(st[k], 0.50);
+        v[k][2] = stats_percentile(st[k], 0.95);
+        v[k][3] = stats_percentile(st[k], 0.99);
+        v[k][4] = stats_max(st[k]);
+        for (int c = 0; c < 5; ++c)
+        {
+            int len = snprintf(buf, sizeof(buf), "%.6f", v[k][c]);
+            if (len > w)
+                w = len;
+        }
+    }
+    printf("distribution of the times in seconds:\n    %-11s", "");
+    for (int c = 0; c < 5; ++c)
+        printf(" %*s", w, head[c]);
+    printf("\n");
+    for (int k = 0; k < rows; ++k)
+    {
+        printf("    %-11s", names[k]);
+        for (int c = 0; c < 5; ++c)
+            printf(" %*.6f", w, v[k][c]);
+        printf("\n");
+    }
+    if (tardiness->n > 0)
+        printf("deadlines: %ld of %ld jobs missed theirs, a miss ratio of "
+               "%.4f\n", (long)missed, (long)tardiness->n,
+               (double)missed / tardiness->n);
+}
+//prints the warm-up of a steady state run and the confidence intervals
+//of its means from the batch means
+void print_steady_state(const struct Simulation *s)
+{
+    const char *names[] = {"Average response time:", "Average turnaround time:",
+                           "Average waiting time:"};
+    printf("steady state: the first %ld jobs were dropped as warm-up, "
+           "%ld measured%s\n", (long)s->warmup, (long)s->response.n,
+           s->converged ? ", the target was met" : "");
+    if (s->no_steady_state)
+        printf("warning: no end to the warm-up was found, half of the run "
+               "was dropped; the run may be too short or overloaded\n");
+    printf("95%% confidence intervals from %d batch means of %ld jobs:\n",
+           s->batches[0].n, (long)s->batches[0].size);
+    for (int k = 0; k < 3; ++k)
+    {
+        double mean, half_width;
+        batch_ci(&s->batches[k], &mean, &half_width);
+        printf("    %-25s%10.6lf +- %.6lf\n", names[k], mean, half_width);
+    }
+}
+//how much a run used its cpus, in u[0] to u[4]: the share of their time
+//a job ran, the share and the cpu-seconds no job ran or waited (the rest
+//went to the scheduler and context switches), the seconds the run lasted
+//and the jobs it finished per second
+static void cpu_usage(const struct Simulation *s, double *u)
+{
+    double elapsed = (double)(s->clock_usec + 1) / 1e6;
+    int cpus = s->n_cpus > 0 ? s->n_cpus : 1;
+    if (elapsed <= 0)
+        elapsed = 1e-6;
+    u[0] = (double)s->busy_usec / 1e6 / (elapsed * cpus);
+    u[1] = (double)s->idle_usec / 1e6 / (elapsed * cpus);
+    u[2] = (double)s->idle_usec / 1e6;
+    u[3] = elapsed;
+    u[4] = s->finished_jobs / elapsed;
+}
+//prints how the n runs used the cpu, averaged over them
+void print_utilisation(const struct Simulation *runs, int n)
+{
+    double avg[5] = {0};
+    for (int r = 0; r < n; ++r)
+    {
+        double u[5];
+        cpu_usage(&runs[r], u);
+        for (int k = 0; k < 5; ++k)
+            avg[k] += u[k] / n;
+    }
+    printf("cpu utilisation %.1f%%, idle %.1f%% (%.3f cpu-sec) of %.3f sec, "
+           "throughput %.3f jobs/sec\n", 100 * avg[0], 100 * avg[1], avg[2],
+           avg[3], avg[4]);
+}
+#ifdef PROFILE
+//prints where the n runs spent their time and what happened in them, all
+//of them together; a phase is only charged while it is the innermost one
+void print_profile(const struct Simulation *runs, int n)
+{
+    const char *phases[] = {"other", "timers", "schedule", "ready",
+                            "arrivals", "stats", "balance"};
+    const char *counts[] = {"events", "arrivals", "ticks", "scheduler runs",
+                            "dispatches", "preemptions", "context switches",
+                            "i/o blocks"};
+    struct Profile all = {0};
+    int64_t finished = 0;
+    for (int r = 0; r < n; ++r)
+    {
+        for (int k = 0; k < N_PHASES; ++k)
+            all.time[k] += runs[r].prof.time[k];
+        for (int k = 0; k < N_COUNTS; ++k)
+            all.count[k] += runs[r].prof.count[k];
+        finished += runs[r].finished_jobs;
+    }
+    uint64_t total = 0;
+    for (int k = 0; k < N_PHASES; ++k)
+        total += all.time[k];
+    double events = all.count[PC_EVENTS] > 0 ?
+                    (double)all.count[PC_EVENTS] : 1;
+    printf("profile of %d run%s, in %s:\n", n, n > 1 ? "s" : "", PROF_UNIT);
+    printf("    %-18s %8s %16s %12s\n", "phase", "share", PROF_UNIT,
+           "per event");
+    for (int k = 0; k < N_PHASES; ++k)
+        printf("    %-18s %7.1f%% %16llu %12.1f\n", phases[k],
+               total ? 100.0 * (double)all.time[k] / (double)total : 0.0,
+               (unsigned long long)all.time[k], (double)all.time[k] / events);
+    printf("    %-18s %8s %16llu %12.1f\n", "total", "",
+           (unsigned long long)total, (double)total / events);
+    printf("    %-18s %12s %12s\n", "count", "", "per job");
+    for (int k = 0; k < N_COUNTS; ++k)
+        printf("    %-18s %12ld %12.2f\n", counts[k], (long)all.count[k],
+               finished ? (double)all.count[k] / (double)finished : 0.0);
+}
+#endif
+//prints how busy each cpu of a run with -cpus was and how many jobs
+//moved, averaged over the n runs; a cpu is busy while a job runs on it,
+//out of the time until the last cpu stopped
+void print_cpus(const struct Simulation *runs, int n)
+{
+    int cpus = runs[0].n_cpus;
+    double all_busy = 0, all_moved = 0;
+    if (n > 1)
+        printf("per cpu, averaged over the replications:\n");
+    else
+        printf("per cpu:\n");
+    printf("    cpu  utilisation  finished  migrated in  migrated out\n");
+    for (int c = 0; c < cpus; ++c)
+    {
+        double busy = 0, finished = 0, in = 0, out = 0;
+        for (int r = 0; r < n; ++r)
+        {
+            const struct CpuReport *cpu = runs[r].cpus;
+            int64_t end = 0;
+            for (int k = 0; k < cpus; ++k)
+                if (cpu[k].end_usec + 1 > end)
+                    end = cpu[k].end_usec + 1;
+            busy += (double)cpu[c].busy_usec / (end > 0 ? end : 1) / n;
+            finished += (double)cpu[c].finished / n;
+            in += (double)cpu[c].migrated_in / n;
+            out += (double)cpu[c].migrated_out / n;
+        }
+        all_busy += busy / cpus;
+        all_moved += in;
+        printf("    %3d  %10.1f%%  %8.0f  %11.0f  %12.0f\n", c, 100 * busy,
+               finished, in, out);
+    }
+    printf("    all  %10.1f%%, %.0f migrations\n", 100 * all_busy, all_moved);
+}
+//prints the share of the cpu time each tenant got next to the share its
+//tickets are worth, averaged over the n runs, and jain's fairness index
+//of how much of its share each one got: 1 if all got exactly theirs,
+//down to 1/tenants if one got everything
+void print_tenants(const struct simulation_params *sp,
+                   const struct Simulation *runs, int n)
+{
+    int64_t all_tickets = 0;
+    double sum = 0, sum_sq = 0;
+    for (int k = 0; k < sp->tenants; ++k)
+        all_tickets += sp->tickets[k];
+    printf("cpu share per tenant:\n");
+    printf("    tenant  tickets  entitled  received\n");
+    for (int k = 0; k < sp->tenants; ++k)
+    {
+        double entitled = (double)sp->tickets[k] / all_tickets, got = 0;
+        for (int r = 0; r < n; ++r)
+        {
+            int64_t total = 0;
+            for (int t = 0; t < sp->tenants; ++t)
+                total += runs[r].tenant_usec[t];
+            got += (double)runs[r].tenant_usec[k] / (total > 0 ? total : 1) / n;
+        }
+        sum += got / entitled;
+        sum_sq += got / entitled * got / entitled;
+        printf("    %6d  %7d  %7.1f%%  %7.1f%%\n", k, sp->tickets[k],
+               100 * entitled, 100 * got);
+    }
+    printf("fairness (jain's index of received over entitled): %.4f\n",
+           sum_sq > 0 ? sum * sum / (sp->tenants * sum_sq) : 1.0);
+}
+//prints str centered in a column w wide, the way the summary tables are
+static void print_centered(const char *str, int w)
+{
+    int len = (int)strlen(str);
+    int left = (w - len + 1) / 2;
+    printf("%*s%s%*s|", left, "", str, w - len - left, "");
+}
+static void print_rule(int w)
+{
+    printf("+-----------+");
+    for (int k = 0; k < 3; ++k)
+        printf("%.*s+", w, "--------------------------------");
+    printf("\n");
+}
+//prints one summary table, a row with the average TT, WT and RT of each
+//algorithm
+void print_table(const struct value_list *algs, double (*avg)[3])
+{
+    const char *head[] = {"Average TT", "Average WT", "Average RT"};
+    char buf[32];
+    int w = (int)strlen(head[0]);
+    for (int a = 0; a < algs->n; ++a)
+        for (int k = 0; k < 3; ++k)
+        {
+            int len = snprintf(buf, sizeof(buf), "%.6f", avg[a][k]);
+            if (len > w)
+                w = len;
+        }
+    w += 2;
+    print_rule(w);
+    printf("|");
+    print_centered("Algorithm", 11);
+    for (int k = 0; k < 3; ++k)
+        print_centered(head[k], w);
+    printf("\n");
+    print_rule(w);
+    for (int a = 0; a < algs->n; ++a)
+    {
+        printf("|");
+        print_centered(alg_names[(int)algs->v[a]], 11);
+        for (int k = 0; k < 3; ++k)
+        {
+            snprintf(buf, sizeof(buf), "%.6f", avg[a][k]);
+            print_centered(buf, w);
+        }
+        printf("\n");
+        print_rule(w);
+    }
+}
+//prints the results of a sweep as summary tables, one per combination of
+//the parameters but the algorithm, and as csv
+int print_sweep(const struct simulation_params *sp,
+                const struct sweep_lists *sw, const struct TaskPool *pool)
+{
+    int reps = sp->replications;
+    int n_cells = pool->n_tasks / reps;
+    bool more = sw->lambdas.n > 1 || sw->cs_times.n > 1 ||
+                sw->tick_times.n > 1 || sw->prob_new_jobs.n > 1;
+    //average TT, WT and RT of each cell over its replications, and their
+    //distributions over the jobs of all of them
+    double (*avg)[3] = calloc(n_cells, sizeof(*avg));
+    struct Stats (*dist)[4] = calloc(n_cells, sizeof(*dist));
+    int64_t *missed = calloc(n_cells, sizeof(int64_t));
+    double (*used)[5] = calloc(n_cells, sizeof(*used));
+    for (int t = 0; t < pool->n_tasks; ++t)
+    {
+        const struct Simulation *run = &pool->runs[t];
+        int c = pool->tasks[t].cell;
+        double u[5];
+        cpu_usage(run, u);
+        for (int k = 0; k < 5; ++k)
+            used[c][k] += u[k] / reps;
+        avg[c][0] += stats_mean(&run->turnaround) / reps;
+        avg[c][1] += stats_mean(&run->waiting) / reps;
+        avg[c][2] += stats_mean(&run->response) / reps;
+        stats_merge(&dist[c][0], &run->turnaround);
+        stats_merge(&dist[c][1], &run->waiting);
+        stats_merge(&dist[c][2], &run->response);
+        stats_merge(&dist[c][3], &run->tardiness);
+        missed[c] += run->missed;
+    }
+    printf("init jobs = %d, sched time = %d, randomize = %s, "
+           "replications = %d\n", sp->init_jobs, sp->sched_time,
+           sp->randomize ? "true" : "false", reps);
+    for (int c = 0; c < n_cells; c += sw->algs.n)
+    {
+        const struct simulation_params *cp = &pool->tasks[c * reps].sp;
+        printf("SIMULATION OF %d JOBS\n", cp->total_jobs);
+        if (more)
+            printf("lambda = %.6f, context switch time = %d, tick time = %d, "
+                   "prob of new job = %.6f\n", cp->lambda,
+                   cp->cont_swtch_time, cp->tick_time, cp->prob_new_job);
+        print_table(&sw->algs, &avg[c]);
+    }
+
+    FILE *csv = stdout;
+    if (sp->csv && !(csv = fopen(sp->csv, "w")))
+    {
+        perror(sp->csv);
+        free(avg);
+        free(dist);
+        free(missed);
+        free(used);
+        return 1;
+    }
+    if (csv == stdout)
+        printf("\n");
+    fprintf(csv, "algorithm,total_jobs,lambda,cs_time,tick_time,"
+                 "prob_new_job,replications,average_turnaround_time,"
+                 "average_waiting_time,average_response_time");
+    const char *kinds[] = {"turnaround", "waiting", "response"};
+    for (int k = 0; k < 3; ++k)
+        fprintf(csv, ",p50_%s_time,p95_%s_time,p99_%s_time,max_%s_time",
+                kinds[k], kinds[k], kinds[k], kinds[k]);
+    fprintf(csv, ",measured_jobs,deadline_miss_ratio,p50_tardiness,"
+                 "p95_tardiness,p99_tardiness,max_tardiness,utilisation,"
+                 "idle,idle_sec,elapsed_sec,throughput\n");
+    for (int c = 0; c < n_cells; ++c)
+    {
+        const struct simulation_params *cp = &pool->tasks[c * reps].sp;
+        fprintf(csv, "%s,%d,%f,%d,%d,%f,%d,%f,%f,%f",
+                alg_names[cp->sched_alg], cp->total_jobs, cp->lambda,
+                cp->cont_swtch_time, cp->tick_time, cp->prob_new_job, reps,
+                avg[c][0], avg[c][1], avg[c][2]);
+        for (int k = 0; k < 3; ++k)
+            fprintf(csv, ",%f,%f,%f,%f", stats_percentile(&dist[c][k], 0.50),
+                    stats_percentile(&dist[c][k], 0.95),
+                    stats_percentile(&dist[c][k], 0.99),
+                    stats_max(&dist[c][k]));
+        //per replication, fewer than total_jobs with a warm-up or ci_target
+        fprintf(csv, ",%.0f", (double)dist[c][0].n / reps);
+        //the jobs with deadlines, over the whole runs
+        const struct Stats *late = &dist[c][3];
+        fprintf(csv, ",%f,%f,%f,%f,%f",
+                late->n ? (double)missed[c] / late->n : 0.0,
+                stats_percentile(late, 0.50), stats_percentile(late, 0.95),
+                stats_percentile(late, 0.99), stats_max(late));
+        //per replication
+        fprintf(csv, ",%f,%f,%f,%f,%f\n", used[c][0], used[c][1],
+                used[c][2], used[c][3], used[c][4]);
+    }
+    if (csv != stdout)
+        fclose(csv);
+    free(avg);
+    free(dist);
+    free(missed);
+    free(used);
+    return 0;
+}
+//the parameters of a run without arguments
+void default_params(struct simulation_params *sp)
+{
+    *sp = (struct simulation_params){
+        .sched_alg = UNDEFINED,
+        .init_jobs = DEFAULT_INIT_JOBS,
+        .total_jobs = DEFAULT_TOTAL_JOBS,
+        .lambda = DEFAULT_LAMBDA,
+        .sched_time = DEFAULT_SCHED_TIME,
+        .cont_swtch_time = DEFAULT_CONT_SWTCH_TIME,
+        .tick_time = DEFAULT_TICK_TIME,
+        .prob_new_job = DEFAULT_PROB_NEW_JOB,
+        .randomize = DEFAULT_RANDOMIZE,
+        .seed = DEFAULT_SEED,
+        .replications = DEFAULT_REPLICATIONS,
+        .warmup = DEFAULT_WARMUP,
+        .ci_target = DEFAULT_CI_TARGET,
+        .mlfq_levels = DEFAULT_MLFQ_LEVELS,
+        .mlfq_quanta = {1, 2, 4},
+        .mlfq_boost = DEFAULT_MLFQ_BOOST,
+        .cfs_latency = DEFAULT_CFS_LATENCY,
+        .cfs_min_gran = DEFAULT_CFS_MIN_GRAN,
+        .cpus = DEFAULT_CPUS,
+        .balance = BAL_STEAL,
+        .balance_interval = DEFAULT_BALANCE_INTERVAL,
+        .tenants = 1,
+        .tickets = {DEFAULT_TICKETS},
+        .io_time = DEFAULT_IO_TIME,
+        .threads = (int)sysconf(_SC_NPROCESSORS_ONLN)
+    };
+}
+int main(int argc, char *argv[])
+{
+    progname = argv[0];
+    struct simulation_params sim_params;
+    default_params(&sim_params);
+
+    struct sweep_lists sw = {0};
+    if (process_args(argc, argv, &sim_params, &sw) != 0)
+    {
+        sweep_free(&sw);
+        return EXIT_FAILURE;
+    }
+
+    if (sim_params.decode || sim_params.convert)
+    {
+        int ret;
+        if (sim_params.decode)
+            ret = decode_records(sim_params.decode, sim_params.csv);
+        else if (!sim_params.workload)
+        {
+            usage("Error: -convert needs the -workload file to write\n");
+            ret = 1;
+        }
+        else
+            ret = workload_convert(sim_params.convert, sim_params.workload);
+        sweep_free(&sw);
+        return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    //set random flags
+    if (sim_params.randomize == true)
+        sim_params.seed = (uint64_t)time(NULL);
+    if (sim_params.sched_alg == UNDEFINED)
+    {
+        //quit if no scheduling algorithm is specified
+        usage("No schedule algorithm is specified\n");
+        sweep_free(&sw);
+        return EXIT_FAILURE;
+    }
+    //a replayed workload brings all of its jobs, by default all are run
+    struct Workload workload;
+    if (sim_params.workload)
+    {
+        if (workload_open(&workload, sim_params.workload))
+        {
+            sweep_free(&sw);
+            return EXIT_FAILURE;
         }
-        //count the wait and turnaround time for the process in the queue
-        //note if the scheduler or context switch is going on, it won't get here
-        for (int i = 0; i < job_count; ++i) {
-            if (jobs[i].state==1&&!context_switch_running)
+        sim_params.replay = &workload;
+        sim_params.init_jobs = 0;
+        sim_params.crn = false;
+        if (sw.total_jobs.n == 0)
+            sim_params.total_jobs = (int)(workload.n < INT32_MAX ?
+                                          workload.n : INT32_MAX);
+        for (int k = 0; k < sw.total_jobs.n; ++k)
+            if (sw.total_jobs.v[k] > (double)workload.n)
             {
-                if (sim_params.sched_alg!=FCFS)
-                    jobs[i].wait_time++;
-                jobs[i].turnaround_time++;
+                fprintf(stderr, "%s: only %ld jobs\n", sim_params.workload,
+                        (long)workload.n);
+                workload_close(&workload);
+                sweep_free(&sw);
+                return EXIT_FAILURE;
             }
+    }
+    //parameters that are not swept keep their single value
+    if (sw.algs.n == 0)
+        list_add(&sw.algs, sim_params.sched_alg);
+    if (sw.total_jobs.n == 0)
+        list_add(&sw.total_jobs, sim_params.total_jobs);
+    if (sw.lambdas.n == 0)
+        list_add(&sw.lambdas, sim_params.lambda);
+    if (sw.cs_times.n == 0)
+        list_add(&sw.cs_times, sim_params.cont_swtch_time);
+    if (sw.tick_times.n == 0)
+        list_add(&sw.tick_times, sim_params.tick_time);
+    if (sw.prob_new_jobs.n == 0)
+        list_add(&sw.prob_new_jobs, sim_params.prob_new_job);
+
+    struct Recorder recorder;
+    if (sim_params.record)
+    {
+        if (!(recorder.f = fopen(sim_params.record, "wb")))
+        {
+            perror(sim_params.record);
+            if (sim_params.workload)
+                workload_close(&workload);
+            sweep_free(&sw);
+            return EXIT_FAILURE;
         }
+        //large blocks come in, so a buffer of its own would only copy them
+        setvbuf(recorder.f, NULL, _IONBF, 0);
+        fwrite(record_magic, sizeof(record_magic), 1, recorder.f);
+        pthread_mutex_init(&recorder.lock, NULL);
     }
 
+    //one task per replication of every combination, the algorithm changing
+    //fastest so the cells of one table are next to each other
+    int reps = sim_params.replications;
+    struct TaskPool pool = {0};
+    pool.n_tasks = sw.algs.n * sw.total_jobs.n * sw.lambdas.n *
+                   sw.cs_times.n * sw.tick_times.n * sw.prob_new_jobs.n * reps;
+    pool.tasks = malloc(pool.n_tasks * sizeof(struct Task));
+    //with -crn the algorithms of a cell share the workload of each
+    //replication, it is generated once instead of once per algorithm
+    int n_traces = sim_params.crn ? pool.n_tasks / sw.algs.n : 0;
+    struct Trace **traces = malloc((n_traces + 1) * sizeof(struct Trace *));
+    int t = 0;
+    for (int j = 0; j < sw.total_jobs.n; ++j)
+    for (int l = 0; l < sw.lambdas.n; ++l)
+    for (int cs = 0; cs < sw.cs_times.n; ++cs)
+    for (int tk = 0; tk < sw.tick_times.n; ++tk)
+    for (int p = 0; p < sw.prob_new_jobs.n; ++p)
+    for (int a = 0; a < sw.algs.n; ++a)
+    for (int r = 0; r < reps; ++r, ++t)
+    {
+        struct simulation_params *sp = &pool.tasks[t].sp;
+        *sp = sim_params;
+        sp->sched_alg = (enum sched_alg_T)sw.algs.v[a];
+        sp->total_jobs = (int)sw.total_jobs.v[j];
+        sp->lambda = sw.lambdas.v[l];
+        sp->cont_swtch_time = (int)sw.cs_times.v[cs];
+        sp->tick_time = (int)sw.tick_times.v[tk];
+        sp->prob_new_job = sw.prob_new_jobs.v[p];
+        sp->seed += r;
+        pool.tasks[t].cell = t / reps;
+        pool.tasks[t].trace = NULL;
+        if (sim_params.crn)
+        {
+            int tr = (t / reps / sw.algs.n) * reps + r;
+            if (a == 0)
+                traces[tr] = trace_new(sp);
+            pool.tasks[t].trace = traces[tr];
+        }
+    }
+    if (sim_params.record)
+        pool.recorder = &recorder;
+    run_tasks(&pool, sim_params.threads);
+    if (sim_params.record)
+    {
+        fclose(recorder.f);
+        pthread_mutex_destroy(&recorder.lock);
+    }
+    if (sim_params.workload)
+        workload_close(&workload);
+    for (int i = 0; i < n_traces; ++i)
+        trace_free(traces[i]);
+    free(traces);
 
+    if (pool.n_tasks > reps)
+    {
+        int ret = print_sweep(&sim_params, &sw, &pool);
+#ifdef PROFILE
+        print_profile(pool.runs, pool.n_tasks);
+#endif
+        for (int i = 0; i < pool.n_tasks; ++i)
+            free(pool.runs[i].cpus);
+        free(pool.tasks);
+        free(pool.runs);
+        sweep_free(&sw);
+        return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
     //Print info using provided code
     printf("For a simulation using the %s scheduling algorithm\n",
            alg_names[sim_params.sched_alg]);
@@ -519,11 +3705,87 @@ int main(int argc, char *argv[])
     printf("    prob of new job     = %.6f\n", sim_params.prob_new_job);
     printf("    randomize           = %s\n",
            sim_params.randomize ? "true" : "false");
-    printf("the following results were obtained:\n");
-    printf("    Average response time:   %10.6lf\n", average_response_time);
-    printf("    Average turnaround time: %10.6lf\n",
-           average_turnaround_time);
-    printf("    Average waiting time:    %10.6lf\n", average_waiting_time);
+    if (sim_params.cpus > 1)
+        printf("    cpus                = %d, %s balancing\n",
+               sim_params.cpus, balance_names[sim_params.balance]);
+    if (sim_params.io_bursts > 0)
+        printf("    i/o bursts          = %d of %g msec on average\n",
+               sim_params.io_bursts, sim_params.io_time);
+    if (reps == 1)
+    {
+        struct Simulation *sim = &pool.runs[0];
+        printf("the following results were obtained:\n");
+        printf("    Average response time:   %10.6lf\n",
+               stats_mean(&sim->response));
+        printf("    Average turnaround time: %10.6lf\n",
+               stats_mean(&sim->turnaround));
+        printf("    Average waiting time:    %10.6lf\n",
+               stats_mean(&sim->waiting));
+        print_distribution(&sim->response, &sim->turnaround, &sim->waiting,
+                           &sim->tardiness, sim->missed);
+        if (sim_params.warmup != 0 || sim_params.ci_target > 0)
+            print_steady_state(sim);
+        print_utilisation(sim, 1);
+        if (sim_params.cpus > 1)
+            print_cpus(sim, 1);
+        if (sim_params.tenants > 1)
+            print_tenants(&sim_params, sim, 1);
+    }
+    else
+    {
+        int n = reps;
+        double *response = malloc(n * sizeof(double));
+        double *turnaround = malloc(n * sizeof(double));
+        double *waiting = malloc(n * sizeof(double));
+        //the jobs of all replications together, merged into the first;
+        //what each one measured is counted before that
+        struct Simulation *all = &pool.runs[0];
+        double warmup = 0, measured = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            warmup += (double)pool.runs[i].warmup / n;
+            measured += (double)pool.runs[i].response.n / n;
+            response[i] = stats_mean(&pool.runs[i].response);
+            turnaround[i] = stats_mean(&pool.runs[i].turnaround);
+            waiting[i] = stats_mean(&pool.runs[i].waiting);
+            if (i > 0)
+            {
+                stats_merge(&all->response, &pool.runs[i].response);
+                stats_merge(&all->turnaround, &pool.runs[i].turnaround);
+                stats_merge(&all->waiting, &pool.runs[i].waiting);
+                stats_merge(&all->tardiness, &pool.runs[i].tardiness);
+                all->missed += pool.runs[i].missed;
+            }
+        }
+        printf("the following results were obtained from %d replications\n"
+               "(mean +- half width of the 95%% confidence interval):\n", n);
+        print_ci("Average response time:", response, n);
+        print_ci("Average turnaround time:", turnaround, n);
+        print_ci("Average waiting time:", waiting, n);
+        printf("over the jobs of all replications, ");
+        print_distribution(&all->response, &all->turnaround, &all->waiting,
+                           &all->tardiness, all->missed);
+        if (sim_params.warmup != 0 || sim_params.ci_target > 0)
+            printf("steady state: %.0f jobs dropped as warm-up and %.0f "
+                   "measured per replication on average\n", warmup, measured);
+        printf("on average, ");
+        print_utilisation(pool.runs, n);
+        if (sim_params.cpus > 1)
+            print_cpus(pool.runs, n);
+        if (sim_params.tenants > 1)
+            print_tenants(&sim_params, pool.runs, n);
+        free(response);
+        free(turnaround);
+        free(waiting);
+    }
+#ifdef PROFILE
+    print_profile(pool.runs, pool.n_tasks);
+#endif
+    for (int i = 0; i < pool.n_tasks; ++i)
+        free(pool.runs[i].cpus);
+    free(pool.tasks);
+    free(pool.runs);
+    sweep_free(&sw);
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,179 @@
+/*
+ * File:	sim_bench.c
+ *
+ * Purpose:	benchmark of the simulator in A3.c. It runs fcfs, sjf and rr
+ *          with 50, 5000 and 500000 jobs, the runs of "Summary Tables.txt",
+ *          on a fixed seed and prints for each one the wall time, the
+ *          events handled per second, the simulated seconds per wall
+ *          second, the peak resident memory and the number of allocations;
+ *          the same goes to a json file so that runs of different commits
+ *          can be compared.
+ *          Each run is a child process of its own, so its peak memory is
+ *          its own; the allocations are counted by routing the malloc,
+ *          calloc and realloc calls of A3.c, which is compiled in here.
+ *
+ * Usage:	sim_bench [json file (default bench.json)] [largest jobs
+ *          (default 500000)]
+ */
+
+
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <stdbool.h>
+#include    <stdint.h>
+#include    <string.h>
+#include    <math.h>
+#include    <time.h>
+#include    <unistd.h>
+#include    <pthread.h>
+#include    <stdatomic.h>
+#include    <fcntl.h>
+#include    <sys/mman.h>
+#include    <sys/stat.h>
+#include    <sys/resource.h>
+#include    <sys/wait.h>
+
+#define     BENCH_SEED              1
+
+static long n_allocs;
+
+static void *count_malloc(size_t size)
+{
+    n_allocs++;
+    return malloc(size);
+}
+static void *count_calloc(size_t n, size_t size)
+{
+    n_allocs++;
+    return calloc(n, size);
+}
+static void *count_realloc(void *p, size_t size)
+{
+    n_allocs++;
+    return realloc(p, size);
+}
+
+//the simulator, with its allocations counted and its main renamed
+#define     malloc(size)            count_malloc(size)
+#define     calloc(n, size)         count_calloc(n, size)
+#define     realloc(p, size)        count_realloc(p, size)
+#define     main                    a3_main
+#include    "../A3.c"
+#undef      main
+#undef      malloc
+#undef      calloc
+#undef      realloc
+
+//what a run sends back to the parent
+struct BenchResult {
+    double wall_sec;
+    int64_t events;
+    double sim_sec;
+    long allocs;
+    int finished;
+};
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//runs alg with total_jobs jobs in a child process; returns its peak
+//resident memory in kB, -1 if it failed
+static long bench_run(enum sched_alg_T alg, int total_jobs,
+                      struct BenchResult *res)
+{
+    int fd[2];
+    if (pipe(fd) != 0)
+        return -1;
+    pid_t pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0)
+    {
+        struct simulation_params sp;
+        default_params(&sp);
+        sp.sched_alg = alg;
+        sp.total_jobs = total_jobs;
+        sp.seed = BENCH_SEED;
+        struct Simulation s;
+        n_allocs = 0;
+        double t0 = now_sec();
+        simulate(&sp, NULL, NULL, 0, &s);
+        struct BenchResult r = {
+                .wall_sec = now_sec() - t0,
+                .events = s.n_events,
+                .sim_sec = (double)(s.clock_usec + 1) / 1e6,
+                .allocs = n_allocs,
+                .finished = s.finished_jobs
+        };
+        bool ok = write(fd[1], &r, sizeof(r)) == sizeof(r);
+        _exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    close(fd[1]);
+    bool ok = read(fd[0], res, sizeof(*res)) == sizeof(*res);
+    close(fd[0]);
+    int status;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) != pid || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != EXIT_SUCCESS || !ok)
+        return -1;
+    return ru.ru_maxrss;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *json = argc > 1 ? argv[1] : "bench.json";
+    int largest = argc > 2 ? atoi(argv[2]) : 500000;
+    if (largest <= 0)
+    {
+        fprintf(stderr, "Usage: %s [json file] [largest jobs]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    progname = argv[0];
+    enum sched_alg_T algs[] = {FCFS, SJF, RR};
+    int jobs[] = {50, 5000, 500000};
+    FILE *out = fopen(json, "w");
+    if (!out)
+    {
+        perror(json);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(out, "{\n  \"seed\": %d,\n  \"runs\": [", BENCH_SEED);
+    printf("%-5s %7s %9s %10s %12s %12s %9s %8s\n", "alg", "jobs",
+           "wall sec", "events", "events/sec", "sim sec/sec", "rss kB",
+           "allocs");
+    int failed = 0, n = 0;
+    for (int j = 0; j < 3 && jobs[j] <= largest; ++j)
+        for (int a = 0; a < 3; ++a)
+        {
+            struct BenchResult r;
+            long rss = bench_run(algs[a], jobs[j], &r);
+            if (rss < 0)
+            {
+                fprintf(stderr, "%s with %d jobs failed\n",
+                        alg_names[algs[a]], jobs[j]);
+                failed++;
+                continue;
+            }
+            double wall = r.wall_sec > 0 ? r.wall_sec : 1e-9;
+            printf("%-5s %7d %9.3f %10ld %12.0f %12.0f %9ld %8ld\n",
+                   alg_names[algs[a]], jobs[j], r.wall_sec, (long)r.events,
+                   r.events / wall, r.sim_sec / wall, rss, r.allocs);
+            fprintf(out, "%s\n    {\"algorithm\": \"%s\", \"jobs\": %d, "
+                         "\"finished\": %d, \"wall_sec\": %.6f, "
+                         "\"events\": %ld, \"events_per_sec\": %.1f, "
+                         "\"sim_sec\": %.6f, \"sim_sec_per_wall_sec\": %.3f, "
+                         "\"peak_rss_kb\": %ld, \"allocations\": %ld}",
+                    n++ ? "," : "", alg_names[algs[a]], jobs[j], r.finished,
+                    r.wall_sec, (long)r.events, r.events / wall, r.sim_sec,
+                    r.sim_sec / wall, rss, r.allocs);
+        }
+    fprintf(out, "\n  ]\n}\n");
+    fclose(out);
+    printf("written to %s\n", json);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+/*
+ * File:	soa_scan.c
+ *
+ * Purpose:	microbenchmark for the job layout used by A3.c. It runs the two
+ *          scans the old simulator did over every job, picking the shortest
+ *          waiting job and charging the waiting jobs, once over the old
+ *          array of struct Job and once over the separate state/remaining/
+ *          ready_since arrays, and prints the time and the memory touched.
+ *
+ * Usage:	soa_scan [jobs (default 500000)] [rounds (default 200)]
+ */
+
+
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <stdint.h>
+#include    <stdbool.h>
+#include    <time.h>
+
+//the job as A3.c used to store it, 72 bytes
+struct OldJob {
+    int64_t remaining;
+    int64_t generated;
+    int64_t compute_time;
+    int64_t passed_time;
+    int state;
+    int64_t wait_time;
+    int64_t response_time;
+    int64_t turnaround_time;
+    bool new;
+};
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//shortest waiting job and wait charging over the array of structs
+static int64_t scan_aos(struct OldJob *jobs, int n)
+{
+    int64_t best = INT64_MAX;
+    int x = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        if (jobs[i].state == 1 && jobs[i].remaining < best)
+        {
+            best = jobs[i].remaining;
+            x = i;
+        }
+    }
+    for (int i = 0; i < n; ++i)
+    {
+        if (jobs[i].state == 1)
+        {
+            jobs[i].wait_time++;
+            jobs[i].turnaround_time++;
+        }
+    }
+    return x;
+}
+
+//the same over the hot arrays, charging is a timestamp per waiting job
+static int64_t scan_soa(const signed char *state, const int64_t *remaining,
+                        int64_t *ready_since, int n)
+{
+    int64_t best = INT64_MAX;
+    int x = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        if (state[i] == 1 && remaining[i] < best)
+        {
+            best = remaining[i];
+            x = i;
+        }
+    }
+    for (int i = 0; i < n; ++i)
+        ready_since[i] -= state[i] == 1;
+    return x;
+}
+
+int main(int argc, char *argv[])
+{
+    int n = argc > 1 ? atoi(argv[1]) : 500000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 200;
+    if (n <= 0 || rounds <= 0)
+    {
+        fprintf(stderr, "Usage: %s [jobs] [rounds]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    struct OldJob *jobs = calloc(n, sizeof(struct OldJob));
+    signed char *state = malloc(n);
+    int64_t *remaining = malloc(n * sizeof(int64_t));
+    int64_t *ready_since = calloc(n, sizeof(int64_t));
+    srandom(1);
+    for (int i = 0; i < n; ++i)
+    {
+        //about a third of the jobs are finished
+        state[i] = jobs[i].state = random() % 3 ? 1 : 2;
+        remaining[i] = jobs[i].remaining = random() % 5000000 + 1;
+    }
+
+    int64_t check = 0;
+    double t0 = now_sec();
+    for (int r = 0; r < rounds; ++r)
+        check += scan_aos(jobs, n);
+    double aos = (now_sec() - t0) / rounds;
+    t0 = now_sec();
+    for (int r = 0; r < rounds; ++r)
+        check -= scan_soa(state, remaining, ready_since, n);
+    double soa = (now_sec() - t0) / rounds;
+
+    //the first scan reads, the second one reads and writes every job
+    double aos_bytes = 3.0 * n * sizeof(struct OldJob);
+    double soa_bytes = n * (2.0 * sizeof(signed char) + sizeof(int64_t) +
+                            2.0 * sizeof(int64_t));
+    printf("jobs %d, rounds %d%s\n", n, rounds, check ? " (mismatch)" : "");
+    printf("%-18s %10s %12s %10s\n", "layout", "usec/scan", "MB/scan",
+           "GB/s");
+    printf("%-18s %10.1f %12.2f %10.2f\n", "array of structs", aos * 1e6,
+           aos_bytes / 1e6, aos_bytes / aos / 1e9);
+    printf("%-18s %10.1f %12.2f %10.2f\n", "hot arrays", soa * 1e6,
+           soa_bytes / 1e6, soa_bytes / soa / 1e9);
+    printf("memory touched per scan: %.1fx less, %.1fx faster\n",
+           aos_bytes / soa_bytes, aos / soa);
+
+    free(jobs);
+    free(state);
+    free(remaining);
+    free(ready_since);
+    return check ? EXIT_FAILURE : EXIT_SUCCESS;
+}